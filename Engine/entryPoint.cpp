@@ -1,11 +1,91 @@
+#include <string>
 #include "src/engine/kEngine.h"
+#include "src/engine/utils.h"
+#include "src/engine/shader/shaderArchive.h"
 #include "logger.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	Log::Init();
-	KEngine engine(1280, 720);
+	//post build step: pack the compiled shaders into the archive and exit, no device is created
+	if (argc == 4 && std::string(argv[1]) == "--pack-shaders")
+	{
+		return ShaderArchive::pack(argv[2], argv[3]) ? 0 : 1;
+	}
+	EngineConfig config;
+	std::string capturePath;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--headless")
+		{
+			config.headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			config.headlessFrames = std::stoul(argv[++i]);
+		}
+		else if (arg == "--frames-in-flight" && i + 1 < argc)
+		{
+			config.framesInFlight = std::stoul(argv[++i]);
+		}
+		else if (arg == "--gpu-trace" && i + 1 < argc)
+		{
+			config.gpuTracePath = argv[++i];
+		}
+		else if (arg == "--cpu-trace" && i + 1 < argc)
+		{
+			config.cpuTracePath = argv[++i];
+		}
+		else if (arg == "--staging-mb" && i + 1 < argc)
+		{
+			config.stagingSizeMB = std::stoul(argv[++i]);
+		}
+		else if (arg == "--no-async-compute")
+		{
+			config.asyncCompute = false;
+		}
+		else if (arg == "--no-wireframe")
+		{
+			config.wireframe = false;
+		}
+		else if (arg == "--no-hot-reload")
+		{
+			config.shaderHotReload = false;
+		}
+		else if (arg == "--no-occlusion-culling")
+		{
+			config.occlusionCulling = false;
+		}
+		else if (arg == "--no-meshlet-culling")
+		{
+			config.meshletCulling = false;
+		}
+		else if (arg == "--no-mesh-shaders")
+		{
+			config.meshShaders = false;
+		}
+		else if (arg == "--no-optimize-meshes")
+		{
+			config.optimizeMeshes = false;
+		}
+		else if (arg == "--pipeline-cache" && i + 1 < argc)
+		{
+			config.pipelineCachePath = argv[++i];
+		}
+		else if (arg == "--capture" && i + 1 < argc)
+		{
+			capturePath = argv[++i];
+		}
+	}
+	KEngine engine(config);
 	engine.init();
+	if (!capturePath.empty())
+	{
+		engine.requestReadback([capturePath](const ReadbackImage& image) {
+			Utils::saveImagePPM(capturePath.c_str(), image);
+		});
+	}
 	engine.run();
 	engine.cleanUp();
 }
\ No newline at end of file
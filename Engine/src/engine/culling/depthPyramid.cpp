@@ -0,0 +1,177 @@
+#include <algorithm>
+#include "depthPyramid.h"
+#include "core.h"
+#include "../vkInitializer.h"
+
+namespace
+{
+	constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+	struct DepthReducePushConstants
+	{
+		uint32_t   srcImage;
+		uint32_t   srcLevel;
+		uint32_t   srcSampler;
+		uint32_t   dstImage;
+		glm::uvec2 dstSize;
+		//uv scale into the source, only level 0 reads a larger image
+		glm::vec2  srcScale;
+	};
+	static_assert(sizeof(DepthReducePushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
+
+	uint32_t ceilPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result < value)
+		{
+			result *= 2;
+		}
+		return result;
+	}
+}
+
+void DepthPyramid::init(VkDevice device, VmaAllocator allocator, BindlessHeap* heap)
+{
+	mDevice = device;
+	mAllocator = allocator;
+	mHeap = heap;
+	VkSamplerReductionModeCreateInfo reductionInfo{};
+	reductionInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO;
+	reductionInfo.pNext = nullptr;
+	reductionInfo.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.pNext = &reductionInfo;
+	//the 2x2 footprint of a linear fetch is reduced to its farthest depth
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	VK_CHECK(vkCreateSampler(mDevice, &samplerInfo, nullptr, &mSampler));
+	mSamplerHandle = mHeap->registerSampler(mSampler);
+}
+
+void DepthPyramid::destroy()
+{
+	DeletionQueue now;
+	retire(now);
+	now.flush();
+	mHeap->free(BindlessType::Sampler, mSamplerHandle);
+	vkDestroySampler(mDevice, mSampler, nullptr);
+}
+
+bool DepthPyramid::resize(VkExtent2D drawExtent, DeletionQueue& retireQueue)
+{
+	//rounding down would leave level 0 texels covering up to 3x3 depth texels, more than one fetch sees
+	VkExtent2D extent{ ceilPowerOfTwo(std::max(drawExtent.width, 1u)), ceilPowerOfTwo(std::max(drawExtent.height, 1u)) };
+	if (mImage && extent.width == mExtent.width && extent.height == mExtent.height)
+	{
+		return false;
+	}
+	retire(retireQueue);
+	create(extent);
+	return true;
+}
+
+void DepthPyramid::create(VkExtent2D extent)
+{
+	mExtent = extent;
+	mLevelCount = 1;
+	while ((std::max(extent.width, extent.height) >> mLevelCount) > 0)
+	{
+		mLevelCount++;
+	}
+	VkImageCreateInfo imageInfo = VkInitializer::createImageInfo(PYRAMID_FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VkExtent3D{ extent.width, extent.height, 1 });
+	imageInfo.mipLevels = mLevelCount;
+	VmaAllocationCreateInfo allocationInfo{};
+	allocationInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	VK_CHECK(vmaCreateImage(mAllocator, &imageInfo, &allocationInfo, &mImage, &mAllocation, nullptr));
+
+	VkImageViewCreateInfo viewInfo = VkInitializer::createImageViewInfo(mImage, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, imageInfo.extent);
+	VK_CHECK(vkCreateImageView(mDevice, &viewInfo, nullptr, &mSampledView));
+	mSampledHandle = mHeap->registerSampledImage(mSampledView, VK_IMAGE_LAYOUT_GENERAL);
+	for (uint32_t level = 0; level < mLevelCount; level++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		VkImageView levelView;
+		VK_CHECK(vkCreateImageView(mDevice, &viewInfo, nullptr, &levelView));
+		mLevelViews.push_back(levelView);
+		mLevelHandles.push_back(mHeap->registerStorageImage(levelView));
+	}
+	KS_CORE_INFO("Depth pyramid: {}x{}, {} levels", extent.width, extent.height, mLevelCount);
+}
+
+void DepthPyramid::retire(DeletionQueue& retireQueue)
+{
+	if (!mImage)
+	{
+		return;
+	}
+	//handles are freed with the image, frames in flight may still sample them
+	retireQueue.push_back([device = mDevice, allocator = mAllocator, heap = mHeap, image = mImage, allocation = mAllocation,
+		sampledView = mSampledView, sampledHandle = mSampledHandle, levelViews = mLevelViews, levelHandles = mLevelHandles]() {
+		for (size_t i = 0; i < levelViews.size(); i++)
+		{
+			heap->free(BindlessType::StorageImage, levelHandles[i]);
+			vkDestroyImageView(device, levelViews[i], nullptr);
+		}
+		heap->free(BindlessType::SampledImage, sampledHandle);
+		vkDestroyImageView(device, sampledView, nullptr);
+		vmaDestroyImage(allocator, image, allocation);
+	});
+	mImage = nullptr;
+	mAllocation = nullptr;
+	mSampledView = nullptr;
+	mSampledHandle = INVALID_BINDLESS_HANDLE;
+	mLevelViews.clear();
+	mLevelHandles.clear();
+	mLevelCount = 0;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd, const PipelineManager& pipelines, PipelineHandle reducePipeline, VkPipelineLayout layout,
+	BindlessHandle depth, glm::vec2 depthScale)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.get(reducePipeline));
+	for (uint32_t level = 0; level < mLevelCount; level++)
+	{
+		DepthReducePushConstants pushConstants;
+		pushConstants.srcImage = level == 0 ? depth : mSampledHandle;
+		pushConstants.srcLevel = level == 0 ? 0 : level - 1;
+		pushConstants.srcSampler = mSamplerHandle;
+		pushConstants.dstImage = mLevelHandles[level];
+		pushConstants.dstSize = glm::uvec2(std::max(mExtent.width >> level, 1u), std::max(mExtent.height >> level, 1u));
+		pushConstants.srcScale = level == 0 ? depthScale : glm::vec2(1.0f);
+		vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_ALL, 0, sizeof(DepthReducePushConstants), &pushConstants);
+		VkExtent3D groups = pipelines.groupCount(reducePipeline, VkExtent3D{ pushConstants.dstSize.x, pushConstants.dstSize.y, 1 });
+		vkCmdDispatch(cmd, groups.width, groups.height, groups.depth);
+
+		//the next level samples this one
+		VkImageMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+		barrier.pNext = nullptr;
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = mImage;
+		barrier.subresourceRange = VkInitializer::imageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+		barrier.subresourceRange.baseMipLevel = level;
+		barrier.subresourceRange.levelCount = 1;
+		VkDependencyInfo depInfo{};
+		depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		depInfo.pNext = nullptr;
+		depInfo.imageMemoryBarrierCount = 1;
+		depInfo.pImageMemoryBarriers = &barrier;
+		vkCmdPipelineBarrier2(cmd, &depInfo);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include "../type.h"
+#include "../descriptor/bindlessHeap.h"
+#include "../pipeline/pipelineManager.h"
+
+//hierarchical z: R32 mip chain where every texel holds the farthest depth of the texels below it.
+//level 0 is the draw extent rounded up to powers of two, so each of its texels covers at most 2x2 depth texels.
+//occlusion tests sample it with the max reduction sampler
+class DepthPyramid
+{
+public:
+	void init(VkDevice device, VmaAllocator allocator, BindlessHeap* heap);
+	void destroy();
+	//recreates the pyramid when drawExtent maps to a different size, the old one goes to retireQueue.
+	//returns true when the image changed
+	bool resize(VkExtent2D drawExtent, DeletionQueue& retireQueue);
+	//reduces depth into every level, the graph has put the pyramid in GENERAL and depth in SHADER_READ_ONLY_OPTIMAL.
+	//depthScale maps [0, 1] over the draw extent to the depth image's allocated size
+	void build(VkCommandBuffer cmd, const PipelineManager& pipelines, PipelineHandle reducePipeline, VkPipelineLayout layout,
+		BindlessHandle depth, glm::vec2 depthScale);
+	VkImage image() const { return mImage; }
+	VkExtent2D extent() const { return mExtent; }
+	//sampled view of every level, in GENERAL layout
+	BindlessHandle sampledHandle() const { return mSampledHandle; }
+	//max reduction, also used to sample the depth image
+	BindlessHandle samplerHandle() const { return mSamplerHandle; }
+private:
+	void create(VkExtent2D extent);
+	void retire(DeletionQueue& retireQueue);
+private:
+	VkDevice					mDevice{ nullptr };
+	VmaAllocator				mAllocator{ nullptr };
+	BindlessHeap*				mHeap{ nullptr };
+	VkSampler					mSampler{ nullptr };
+	BindlessHandle				mSamplerHandle{ INVALID_BINDLESS_HANDLE };
+	VkImage						mImage{ nullptr };
+	VmaAllocation				mAllocation{ nullptr };
+	VkExtent2D					mExtent{ 0, 0 };
+	uint32_t					mLevelCount{ 0 };
+	VkImageView					mSampledView{ nullptr };
+	BindlessHandle				mSampledHandle{ INVALID_BINDLESS_HANDLE };
+	//one storage view per level
+	std::vector<VkImageView>	mLevelViews;
+	std::vector<BindlessHandle> mLevelHandles;
+};
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "meshletBuilder.h"
+
+namespace
+{
+	constexpr uint8_t UNUSED_VERTEX = 0xff;
+	static_assert(MESHLET_MAX_VERTICES < UNUSED_VERTEX, "local vertex indices are 8 bit");
+
+	glm::vec3 position(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& stream, const Meshlet& meshlet, uint32_t triangleWord, uint32_t corner)
+	{
+		uint32_t local = (triangleWord >> (corner * 8)) & 0xff;
+		return vertices[stream[meshlet.vertexOffset + local]].position;
+	}
+
+	void computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& stream, Meshlet& meshlet)
+	{
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			glm::vec3 point = vertices[stream[meshlet.vertexOffset + i]].position;
+			boundsMin = glm::min(boundsMin, point);
+			boundsMax = glm::max(boundsMax, point);
+		}
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			glm::vec3 point = vertices[stream[meshlet.vertexOffset + i]].position;
+			meshlet.radius = std::max(meshlet.radius, glm::length(point - meshlet.center));
+		}
+
+		//unit normals of the non degenerate triangles
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec3> corners;
+		glm::vec3 axis{ 0.0f };
+		for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+		{
+			uint32_t word = stream[meshlet.triangleOffset + triangle];
+			glm::vec3 a = position(vertices, stream, meshlet, word, 0);
+			glm::vec3 normal = glm::cross(position(vertices, stream, meshlet, word, 1) - a, position(vertices, stream, meshlet, word, 2) - a);
+			float length = glm::length(normal);
+			if (length <= std::numeric_limits<float>::epsilon())
+			{
+				continue;
+			}
+			normals.push_back(normal / length);
+			corners.push_back(a);
+			axis += normal / length;
+		}
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = glm::vec3{ 0.0f, 0.0f, 1.0f };
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength <= std::numeric_limits<float>::epsilon())
+		{
+			return;
+		}
+		axis /= axisLength;
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+		//normals over more than a hemisphere, some triangle always faces the camera
+		if (minDot <= 0.0f)
+		{
+			return;
+		}
+		//move the apex back along the axis until every triangle plane is in front of it
+		float maxT = 0.0f;
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			float t = glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+			maxT = std::max(maxT, t);
+		}
+		meshlet.coneApex = meshlet.center - axis * maxT;
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount,
+	std::vector<Meshlet>& meshlets, std::vector<uint32_t>& stream)
+{
+	//mesh vertex -> local index of the meshlet being built
+	std::vector<uint8_t> localIndex(vertices.size(), UNUSED_VERTEX);
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+	auto flush = [&]() {
+		if (meshletTriangles.empty())
+		{
+			return;
+		}
+		Meshlet meshlet;
+		meshlet.vertexOffset = static_cast<uint32_t>(stream.size());
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		stream.insert(stream.end(), meshletVertices.begin(), meshletVertices.end());
+		meshlet.triangleOffset = static_cast<uint32_t>(stream.size());
+		meshlet.triangleCount = static_cast<uint32_t>(meshletTriangles.size());
+		stream.insert(stream.end(), meshletTriangles.begin(), meshletTriangles.end());
+		computeBounds(vertices, stream, meshlet);
+		meshlets.push_back(meshlet);
+		for (uint32_t vertex : meshletVertices)
+		{
+			localIndex[vertex] = UNUSED_VERTEX;
+		}
+		meshletVertices.clear();
+		meshletTriangles.clear();
+	};
+
+	for (uint32_t i = startIndex; i + 2 < startIndex + indexCount; i += 3)
+	{
+		uint32_t triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+		uint32_t newVertices = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+			newVertices += localIndex[triangle[corner]] == UNUSED_VERTEX && !repeated ? 1 : 0;
+		}
+		if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES || meshletTriangles.size() == MESHLET_MAX_TRIANGLES)
+		{
+			flush();
+		}
+		uint32_t word = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint8_t& local = localIndex[triangle[corner]];
+			if (local == UNUSED_VERTEX)
+			{
+				local = static_cast<uint8_t>(meshletVertices.size());
+				meshletVertices.push_back(triangle[corner]);
+			}
+			word |= static_cast<uint32_t>(local) << (corner * 8);
+		}
+		meshletTriangles.push_back(word);
+	}
+	flush();
+}
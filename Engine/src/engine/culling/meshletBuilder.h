@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "../type.h"
+
+//limits of one meshlet, the mesh shader declares the same max_vertices / max_primitives and the
+//meshlet cull shader runs one invocation per triangle
+constexpr static uint32_t MESHLET_MAX_VERTICES	= 64;
+constexpr static uint32_t MESHLET_MAX_TRIANGLES = 128;
+//meshlets culled by one task shader workgroup
+constexpr static uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+
+//small batch of a surface's triangles that references at most MESHLET_MAX_VERTICES vertices.
+//its data in the meshlet stream is vertexCount mesh vertex indices followed by triangleCount
+//words holding three 8 bit indices into those vertices
+struct Meshlet
+{
+	//into the meshlet stream
+	uint32_t  vertexOffset;
+	uint32_t  triangleOffset;
+	uint32_t  vertexCount;
+	uint32_t  triangleCount;
+	//object space bounding sphere
+	glm::vec3 center;
+	float	  radius;
+	//every triangle faces away from a camera inside the cone dot(normalize(apex - camera), axis) >= cutoff.
+	//cutoff is 1 when the normals spread too far for the cone to ever cull
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float	  coneCutoff;
+};
+
+//greedily packs the triangles of [startIndex, startIndex + indexCount) in index order, appending the
+//meshlets and their vertex and triangle words to stream
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount,
+	std::vector<Meshlet>& meshlets, std::vector<uint32_t>& stream);
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include "bindlessHeap.h"
+#include "core.h"
+
+namespace
+{
+	constexpr VkDescriptorType BINDLESS_DESCRIPTOR_TYPES[] = {
+		VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		VK_DESCRIPTOR_TYPE_SAMPLER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	};
+
+	const char* typeName(BindlessType type)
+	{
+		switch (type)
+		{
+		case BindlessType::SampledImage:  return "sampled image";
+		case BindlessType::StorageImage:  return "storage image";
+		case BindlessType::Sampler:		  return "sampler";
+		case BindlessType::StorageBuffer: return "storage buffer";
+		default:						  return "unknown";
+		}
+	}
+}
+
+void BindlessHeap::init(VkDevice device, VkPhysicalDevice physicalDevice, const Capacity& capacity)
+{
+	mDevice = device;
+	VkPhysicalDeviceVulkan12Properties properties12{};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	//the arrays are visible to every stage, so the per stage limits apply as well
+	mSlots[static_cast<size_t>(BindlessType::SampledImage)].capacity = std::min({ capacity.sampledImages,
+		properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	mSlots[static_cast<size_t>(BindlessType::StorageImage)].capacity = std::min({ capacity.storageImages,
+		properties12.maxDescriptorSetUpdateAfterBindStorageImages, properties12.maxPerStageDescriptorUpdateAfterBindStorageImages });
+	mSlots[static_cast<size_t>(BindlessType::Sampler)].capacity = std::min({ capacity.samplers,
+		properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSamplers });
+	mSlots[static_cast<size_t>(BindlessType::StorageBuffer)].capacity = std::min({ capacity.storageBuffers,
+		properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+	constexpr size_t typeCount = static_cast<size_t>(BindlessType::Count);
+	//the sums are limited too, shrink the arrays in proportion until they fit
+	auto fitTotal = [&](uint32_t typeMask, uint32_t limit, const char* limitName) {
+		uint64_t total = 0;
+		for (uint32_t i = 0; i < typeCount; i++)
+		{
+			total += (typeMask & (1u << i)) ? mSlots[i].capacity : 0;
+		}
+		if (total <= limit)
+		{
+			return;
+		}
+		KS_CORE_WARN("Bindless heap holds {} descriptors but {} is {}, shrinking it", total, limitName, limit);
+		for (uint32_t i = 0; i < typeCount; i++)
+		{
+			if (typeMask & (1u << i))
+			{
+				mSlots[i].capacity = static_cast<uint32_t>(mSlots[i].capacity * static_cast<uint64_t>(limit) / total);
+			}
+		}
+	};
+	//samplers are not resources, but every stage sees the other arrays and its color attachments
+	uint32_t resourceTypes = (1u << static_cast<uint32_t>(BindlessType::SampledImage)) | (1u << static_cast<uint32_t>(BindlessType::StorageImage)) |
+		(1u << static_cast<uint32_t>(BindlessType::StorageBuffer));
+	uint32_t colorAttachments = properties.properties.limits.maxColorAttachments;
+	uint32_t resourceLimit = properties12.maxPerStageUpdateAfterBindResources;
+	fitTotal(resourceTypes, resourceLimit > colorAttachments ? resourceLimit - colorAttachments : 0, "maxPerStageUpdateAfterBindResources");
+	fitTotal((1u << typeCount) - 1, properties12.maxUpdateAfterBindDescriptorsInAllPools, "maxUpdateAfterBindDescriptorsInAllPools");
+	VkDescriptorSetLayoutBinding bindings[typeCount]{};
+	VkDescriptorBindingFlags bindingFlags[typeCount]{};
+	VkDescriptorPoolSize poolSizes[typeCount]{};
+	for (uint32_t i = 0; i < typeCount; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = BINDLESS_DESCRIPTOR_TYPES[i];
+		bindings[i].descriptorCount = mSlots[i].capacity;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[i].pImmutableSamplers = nullptr;
+		//slots are filled as resources come and go, unused ones may stay unwritten
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		poolSizes[i].type = BINDLESS_DESCRIPTOR_TYPES[i];
+		poolSizes[i].descriptorCount = mSlots[i].capacity;
+		KS_CORE_INFO("Bindless {} slots: {}", typeName(static_cast<BindlessType>(i)), mSlots[i].capacity);
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.pNext = nullptr;
+	flagsInfo.bindingCount = typeCount;
+	flagsInfo.pBindingFlags = bindingFlags;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = typeCount;
+	layoutInfo.pBindings = bindings;
+	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mLayout));
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.pNext = nullptr;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = typeCount;
+	poolInfo.pPoolSizes = poolSizes;
+	VK_CHECK(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mPool));
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.pNext = nullptr;
+	allocateInfo.descriptorPool = mPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &mLayout;
+	VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocateInfo, &mSet));
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = BINDLESS_PUSH_CONSTANT_SIZE;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.pNext = nullptr;
+	pipelineLayoutInfo.flags = 0;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &mLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout));
+}
+
+void BindlessHeap::destroy()
+{
+	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+	vkDestroyDescriptorPool(mDevice, mPool, nullptr);
+	vkDestroyDescriptorSetLayout(mDevice, mLayout, nullptr);
+	for (auto& slots : mSlots)
+	{
+		slots.next = 0;
+		slots.freeList.clear();
+	}
+}
+
+BindlessHandle BindlessHeap::allocateSlot(BindlessType type)
+{
+	Slots& slots = mSlots[static_cast<size_t>(type)];
+	if (!slots.freeList.empty())
+	{
+		BindlessHandle handle = slots.freeList.back();
+		slots.freeList.pop_back();
+		return handle;
+	}
+	KS_CORE_ASSERT(slots.next < slots.capacity, "Bindless heap out of slots");
+	return slots.next++;
+}
+
+void BindlessHeap::free(BindlessType type, BindlessHandle handle)
+{
+	if (handle == INVALID_BINDLESS_HANDLE)
+	{
+		return;
+	}
+	Slots& slots = mSlots[static_cast<size_t>(type)];
+	KS_CORE_ASSERT(handle < slots.next, "Bindless handle was never registered");
+	slots.freeList.push_back(handle);
+}
+
+uint32_t BindlessHeap::usedCount(BindlessType type) const
+{
+	const Slots& slots = mSlots[static_cast<size_t>(type)];
+	return slots.next - static_cast<uint32_t>(slots.freeList.size());
+}
+
+void BindlessHeap::writeImage(BindlessType type, BindlessHandle handle, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = layout;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.pNext = nullptr;
+	write.dstSet = mSet;
+	write.dstBinding = static_cast<uint32_t>(type);
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = BINDLESS_DESCRIPTOR_TYPES[static_cast<size_t>(type)];
+	write.pImageInfo = &imageInfo;
+	write.pBufferInfo = nullptr;
+	vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
+
+BindlessHandle BindlessHeap::registerSampledImage(VkImageView imageView, VkImageLayout layout)
+{
+	BindlessHandle handle = allocateSlot(BindlessType::SampledImage);
+	writeImage(BindlessType::SampledImage, handle, imageView, VK_NULL_HANDLE, layout);
+	return handle;
+}
+
+BindlessHandle BindlessHeap::registerStorageImage(VkImageView imageView)
+{
+	BindlessHandle handle = allocateSlot(BindlessType::StorageImage);
+	writeImage(BindlessType::StorageImage, handle, imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+	return handle;
+}
+
+BindlessHandle BindlessHeap::registerSampler(VkSampler sampler)
+{
+	BindlessHandle handle = allocateSlot(BindlessType::Sampler);
+	writeImage(BindlessType::Sampler, handle, VK_NULL_HANDLE, sampler, VK_IMAGE_LAYOUT_UNDEFINED);
+	return handle;
+}
+
+BindlessHandle BindlessHeap::registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	BindlessHandle handle = allocateSlot(BindlessType::StorageBuffer);
+	updateStorageBuffer(handle, buffer, offset, range);
+	return handle;
+}
+
+void BindlessHeap::updateSampledImage(BindlessHandle handle, VkImageView imageView, VkImageLayout layout)
+{
+	writeImage(BindlessType::SampledImage, handle, imageView, VK_NULL_HANDLE, layout);
+}
+
+void BindlessHeap::updateStorageImage(BindlessHandle handle, VkImageView imageView)
+{
+	writeImage(BindlessType::StorageImage, handle, imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+void BindlessHeap::updateStorageBuffer(BindlessHandle handle, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.pNext = nullptr;
+	write.dstSet = mSet;
+	write.dstBinding = static_cast<uint32_t>(BindlessType::StorageBuffer);
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pImageInfo = nullptr;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
+
+void BindlessHeap::bind(VkCommandBuffer cmd) const
+{
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &mSet, 0, nullptr);
+	bindCompute(cmd);
+}
+
+void BindlessHeap::bindCompute(VkCommandBuffer cmd) const
+{
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mSet, 0, nullptr);
+}
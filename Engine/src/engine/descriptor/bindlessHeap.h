@@ -0,0 +1,70 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+using BindlessHandle = uint32_t;
+constexpr static BindlessHandle INVALID_BINDLESS_HANDLE = ~0u;
+
+enum class BindlessType
+{
+	SampledImage,
+	StorageImage,
+	Sampler,
+	StorageBuffer,
+	Count
+};
+
+//every pipeline push constant block has to fit in the shared range
+constexpr static uint32_t BINDLESS_PUSH_CONSTANT_SIZE = 128;
+
+//one update after bind descriptor set holding every image, sampler and buffer the shaders use,
+//shaders index the arrays with handles passed in push constants or buffers.
+//binding 0 sampled images, 1 storage images, 2 samplers, 3 storage buffers
+class BindlessHeap
+{
+public:
+	struct Capacity
+	{
+		uint32_t sampledImages { 16384 };
+		uint32_t storageImages { 1024  };
+		uint32_t samplers	   { 128   };
+		uint32_t storageBuffers{ 16384 };
+	};
+public:
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, const Capacity& capacity);
+	void destroy();
+	BindlessHandle registerSampledImage(VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	BindlessHandle registerStorageImage(VkImageView imageView);
+	BindlessHandle registerSampler(VkSampler sampler);
+	BindlessHandle registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	//rewrite a slot in place, the slot must not be used by pending command buffers
+	void updateSampledImage(BindlessHandle handle, VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void updateStorageImage(BindlessHandle handle, VkImageView imageView);
+	void updateStorageBuffer(BindlessHandle handle, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	//the handle is reused by the next register, only free it once the gpu is done with it
+	void free(BindlessType type, BindlessHandle handle);
+	//binds the set for graphics and compute, once per command buffer
+	void bind(VkCommandBuffer cmd) const;
+	void bindCompute(VkCommandBuffer cmd) const;
+	VkDescriptorSetLayout layout() const { return mLayout; }
+	VkDescriptorSet set() const { return mSet; }
+	//shared by every pipeline so the set stays bound across pipeline switches
+	VkPipelineLayout pipelineLayout() const { return mPipelineLayout; }
+	uint32_t usedCount(BindlessType type) const;
+private:
+	struct Slots
+	{
+		uint32_t			  capacity{ 0 };
+		uint32_t			  next{ 0 };
+		std::vector<uint32_t> freeList;
+	};
+	BindlessHandle allocateSlot(BindlessType type);
+	void writeImage(BindlessType type, BindlessHandle handle, VkImageView imageView, VkSampler sampler, VkImageLayout layout);
+private:
+	VkDevice			  mDevice{ nullptr };
+	VkDescriptorPool	  mPool{ nullptr };
+	VkDescriptorSetLayout mLayout{ nullptr };
+	VkDescriptorSet		  mSet{ nullptr };
+	VkPipelineLayout	  mPipelineLayout{ nullptr };
+	Slots				  mSlots[static_cast<size_t>(BindlessType::Count)];
+};
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include "geometryBuffer.h"
+#include "core.h"
+#include "../vkInitializer.h"
+
+void GeometryBuffer::init(VkDevice device, VmaAllocator allocator, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity, const std::vector<uint32_t>& queueFamilies)
+{
+	mDevice = device;
+	mAllocator = allocator;
+	mVertexStride = vertexStride;
+	mQueueFamilies = queueFamilies;
+	mVertexAllocator.init(vertexCapacity);
+	mIndexAllocator.init(indexCapacity);
+	createBuffers();
+	KS_CORE_INFO("Geometry buffer: {} vertices ({:.2f} MB), {} indices ({:.2f} MB)",
+		vertexCapacity, static_cast<double>(vertexCapacity) * vertexStride / (1024.0 * 1024.0),
+		indexCapacity, static_cast<double>(indexCapacity) * sizeof(uint32_t) / (1024.0 * 1024.0));
+}
+
+void GeometryBuffer::createBuffers()
+{
+	VkDeviceSize vertexSize = static_cast<VkDeviceSize>(mVertexAllocator.capacity()) * mVertexStride;
+	VkDeviceSize indexSize = static_cast<VkDeviceSize>(mIndexAllocator.capacity()) * sizeof(uint32_t);
+	mVertexBuffer = VkInitializer::createBuffer(mAllocator, vertexSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY, mQueueFamilies);
+	mIndexBuffer = VkInitializer::createBuffer(mAllocator, indexSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY, mQueueFamilies);
+	VkBufferDeviceAddressInfo addressInfo{};
+	addressInfo.buffer = mVertexBuffer.buffer;
+	addressInfo.pNext = nullptr;
+	addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	mVertexAddress = vkGetBufferDeviceAddress(mDevice, &addressInfo);
+	addressInfo.buffer = mIndexBuffer.buffer;
+	mIndexAddress = vkGetBufferDeviceAddress(mDevice, &addressInfo);
+}
+
+void GeometryBuffer::destroy()
+{
+	vmaDestroyBuffer(mAllocator, mVertexBuffer.buffer, mVertexBuffer.allocation);
+	vmaDestroyBuffer(mAllocator, mIndexBuffer.buffer, mIndexBuffer.allocation);
+	mVertexAllocator.reset();
+	mIndexAllocator.reset();
+}
+
+bool GeometryBuffer::allocate(uint32_t vertexCount, uint32_t indexCount, GeometryRange& range)
+{
+	//the allocator only hands out non empty ranges
+	uint32_t vertexOffset = vertexCount > 0 ? mVertexAllocator.allocate(vertexCount) : 0;
+	if (vertexOffset == OffsetAllocator::INVALID_OFFSET)
+	{
+		KS_CORE_ERROR("Geometry buffer out of vertex space: {} requested, {} free", vertexCount, mVertexAllocator.freeSize());
+		return false;
+	}
+	uint32_t firstIndex = indexCount > 0 ? mIndexAllocator.allocate(indexCount) : 0;
+	if (firstIndex == OffsetAllocator::INVALID_OFFSET)
+	{
+		KS_CORE_ERROR("Geometry buffer out of index space: {} requested, {} free", indexCount, mIndexAllocator.freeSize());
+		if (vertexCount > 0)
+		{
+			mVertexAllocator.free(vertexOffset, vertexCount);
+		}
+		return false;
+	}
+	range.vertexOffset = vertexOffset;
+	range.vertexCount = vertexCount;
+	range.firstIndex = firstIndex;
+	range.indexCount = indexCount;
+	return true;
+}
+
+void GeometryBuffer::free(GeometryRange& range)
+{
+	if (range.vertexCount > 0)
+	{
+		mVertexAllocator.free(range.vertexOffset, range.vertexCount);
+	}
+	if (range.indexCount > 0)
+	{
+		mIndexAllocator.free(range.firstIndex, range.indexCount);
+	}
+	range = GeometryRange{};
+}
+
+float GeometryBuffer::fragmentation() const
+{
+	auto rate = [](const OffsetAllocator& allocator) {
+		return allocator.freeSize() == 0 ? 0.0f : 1.0f - static_cast<float>(allocator.largestFreeRange()) / allocator.freeSize();
+	};
+	return std::max(rate(mVertexAllocator), rate(mIndexAllocator));
+}
+
+bool GeometryBuffer::defragment(VkCommandBuffer cmd, const std::vector<GeometryRange*>& liveRanges, DeletionQueue& retireQueue)
+{
+	//plan every packed range before touching the buffers, a failed allocation restores the old layout
+	OffsetAllocator oldVertexAllocator = mVertexAllocator;
+	OffsetAllocator oldIndexAllocator = mIndexAllocator;
+	mVertexAllocator.reset();
+	mIndexAllocator.reset();
+	std::vector<GeometryRange> packedRanges(liveRanges.size());
+	for (size_t i = 0; i < liveRanges.size(); i++)
+	{
+		//allocating in order from an empty allocator packs the ranges front to back
+		if (!allocate(liveRanges[i]->vertexCount, liveRanges[i]->indexCount, packedRanges[i]))
+		{
+			KS_CORE_ERROR("Geometry buffer defragment failed, keeping the current layout");
+			mVertexAllocator = oldVertexAllocator;
+			mIndexAllocator = oldIndexAllocator;
+			return false;
+		}
+		packedRanges[i].indexType = liveRanges[i]->indexType;
+	}
+
+	//frames in flight keep reading the old buffers, so pack into new ones instead of moving in place
+	AllocatedBuffer oldVertexBuffer = mVertexBuffer;
+	AllocatedBuffer oldIndexBuffer = mIndexBuffer;
+	retireQueue.push_back([allocator = mAllocator, oldVertexBuffer, oldIndexBuffer]() {
+		vmaDestroyBuffer(allocator, oldVertexBuffer.buffer, oldVertexBuffer.allocation);
+		vmaDestroyBuffer(allocator, oldIndexBuffer.buffer, oldIndexBuffer.allocation);
+	});
+	createBuffers();
+
+	std::vector<VkBufferCopy2> vertexCopies;
+	std::vector<VkBufferCopy2> indexCopies;
+	for (size_t i = 0; i < liveRanges.size(); i++)
+	{
+		GeometryRange* range = liveRanges[i];
+		const GeometryRange& packed = packedRanges[i];
+		VkBufferCopy2 copy{};
+		copy.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
+		copy.pNext = nullptr;
+		copy.srcOffset = vertexByteOffset(*range);
+		copy.dstOffset = vertexByteOffset(packed);
+		copy.size = static_cast<VkDeviceSize>(range->vertexCount) * mVertexStride;
+		if (copy.size > 0)
+		{
+			vertexCopies.push_back(copy);
+		}
+		copy.srcOffset = indexByteOffset(*range);
+		copy.dstOffset = indexByteOffset(packed);
+		copy.size = static_cast<VkDeviceSize>(range->indexCount) * sizeof(uint32_t);
+		if (copy.size > 0)
+		{
+			indexCopies.push_back(copy);
+		}
+		*range = packed;
+	}
+
+	VkCopyBufferInfo2 copyInfo{};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
+	copyInfo.pNext = nullptr;
+	if (!vertexCopies.empty())
+	{
+		copyInfo.srcBuffer = oldVertexBuffer.buffer;
+		copyInfo.dstBuffer = mVertexBuffer.buffer;
+		copyInfo.regionCount = static_cast<uint32_t>(vertexCopies.size());
+		copyInfo.pRegions = vertexCopies.data();
+		vkCmdCopyBuffer2(cmd, &copyInfo);
+	}
+	if (!indexCopies.empty())
+	{
+		copyInfo.srcBuffer = oldIndexBuffer.buffer;
+		copyInfo.dstBuffer = mIndexBuffer.buffer;
+		copyInfo.regionCount = static_cast<uint32_t>(indexCopies.size());
+		copyInfo.pRegions = indexCopies.data();
+		vkCmdCopyBuffer2(cmd, &copyInfo);
+	}
+
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.pNext = nullptr;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.pNext = nullptr;
+	depInfo.memoryBarrierCount = 1;
+	depInfo.pMemoryBarriers = &barrier;
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+	KS_CORE_INFO("Geometry buffer defragmented: {} ranges, {} vertices and {} indices in use",
+		liveRanges.size(), mVertexAllocator.usedSize(), mIndexAllocator.usedSize());
+	return true;
+}
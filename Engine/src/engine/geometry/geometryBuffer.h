@@ -0,0 +1,48 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include "../type.h"
+#include "offsetAllocator.h"
+
+//one device local vertex buffer and one index buffer shared by every mesh, sub-allocated in
+//vertices and 32 bit words. meshes draw with vertexOffset/firstElement, the index buffer is bound
+//once per index type
+class GeometryBuffer
+{
+public:
+	void init(VkDevice device, VmaAllocator allocator, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity, const std::vector<uint32_t>& queueFamilies);
+	void destroy();
+	//a zero vertex or index count is a valid empty part of the range at offset 0
+	bool allocate(uint32_t vertexCount, uint32_t indexCount, GeometryRange& range);
+	//the caller makes sure no frame in flight still reads the range
+	void free(GeometryRange& range);
+	//share of the free space that is not part of the largest free range
+	float fragmentation() const;
+	//packs the given live ranges into new buffers and rewrites them, the copies are recorded into cmd
+	//followed by a barrier for vertex/index reads. the old buffers are handed to retireQueue.
+	//false leaves the buffers and every range untouched
+	bool defragment(VkCommandBuffer cmd, const std::vector<GeometryRange*>& liveRanges, DeletionQueue& retireQueue);
+	VkBuffer vertexBuffer() const { return mVertexBuffer.buffer; }
+	VkBuffer indexBuffer() const { return mIndexBuffer.buffer; }
+	VkDeviceAddress vertexAddress() const { return mVertexAddress; }
+	//the meshlet shaders read the indices and meshlet streams directly
+	VkDeviceAddress indexAddress() const { return mIndexAddress; }
+	VkDeviceSize vertexByteOffset(const GeometryRange& range) const { return static_cast<VkDeviceSize>(range.vertexOffset) * mVertexStride; }
+	VkDeviceSize indexByteOffset(const GeometryRange& range) const { return static_cast<VkDeviceSize>(range.firstIndex) * sizeof(uint32_t); }
+	//firstIndex of a draw from the start of the range, counted in the range's index type
+	static uint32_t firstElement(const GeometryRange& range) { return range.indexType == VK_INDEX_TYPE_UINT16 ? range.firstIndex * 2 : range.firstIndex; }
+private:
+	void createBuffers();
+private:
+	VkDevice			  mDevice{ nullptr };
+	VmaAllocator		  mAllocator{ nullptr };
+	uint32_t			  mVertexStride{ 0 };
+	std::vector<uint32_t> mQueueFamilies;
+	AllocatedBuffer		  mVertexBuffer{};
+	AllocatedBuffer		  mIndexBuffer{};
+	VkDeviceAddress		  mVertexAddress{ 0 };
+	VkDeviceAddress		  mIndexAddress{ 0 };
+	OffsetAllocator		  mVertexAllocator;
+	OffsetAllocator		  mIndexAllocator;
+};
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <limits>
+#include "meshOptimizer.h"
+
+namespace
+{
+	constexpr uint32_t INVALID_VERTEX = std::numeric_limits<uint32_t>::max();
+
+	//the vertices a surface references, the passes work on indices rebased onto [0, count)
+	struct VertexSpan
+	{
+		uint32_t first{ 0 };
+		uint32_t count{ 0 };
+	};
+
+	VertexSpan vertexSpan(const std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount)
+	{
+		if (indexCount == 0)
+		{
+			return VertexSpan{};
+		}
+		auto [low, high] = std::minmax_element(indices.begin() + startIndex, indices.begin() + startIndex + indexCount);
+		return VertexSpan{ *low, *high - *low + 1 };
+	}
+
+	//FIFO by timestamps, a vertex stays cached until cacheSize other vertices missed after it
+	class VertexCache
+	{
+	public:
+		VertexCache(uint32_t vertexCount, uint32_t cacheSize)
+			: mTimestamps(vertexCount, 0), mCacheSize(cacheSize), mTime(cacheSize + 1)
+		{
+		}
+		//true when the vertex had to be transformed
+		bool access(uint32_t vertex)
+		{
+			if (mTime - mTimestamps[vertex] <= mCacheSize)
+			{
+				return false;
+			}
+			mTimestamps[vertex] = mTime++;
+			return true;
+		}
+		uint32_t access(const uint32_t* triangle, uint32_t baseVertex)
+		{
+			return access(triangle[0] - baseVertex) + access(triangle[1] - baseVertex) + access(triangle[2] - baseVertex);
+		}
+		void flush() { mTime += mCacheSize + 1; }
+	private:
+		std::vector<uint32_t> mTimestamps;
+		uint32_t			  mCacheSize;
+		uint32_t			  mTime;
+	};
+
+	struct Cluster
+	{
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+		float	 sortKey;
+	};
+}
+
+namespace MeshOptimizer
+{
+	uint32_t simulateVertexCache(const std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount, uint32_t cacheSize)
+	{
+		VertexSpan span = vertexSpan(indices, startIndex, indexCount);
+		VertexCache cache(span.count, cacheSize);
+		uint32_t misses = 0;
+		for (uint32_t i = startIndex; i + 3 <= startIndex + indexCount; i += 3)
+		{
+			misses += cache.access(&indices[i], span.first);
+		}
+		return misses;
+	}
+
+	void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount, uint32_t cacheSize)
+	{
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+		VertexSpan span = vertexSpan(indices, startIndex, triangleCount * 3);
+		const uint32_t* source = indices.data() + startIndex;
+
+		//triangles around each vertex, liveCount drops as they are emitted
+		std::vector<uint32_t> liveCount(span.count, 0);
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			liveCount[source[i] - span.first]++;
+		}
+		std::vector<uint32_t> adjacencyOffset(span.count + 1, 0);
+		for (uint32_t vertex = 0; vertex < span.count; vertex++)
+		{
+			adjacencyOffset[vertex + 1] = adjacencyOffset[vertex] + liveCount[vertex];
+		}
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[fill[source[i] - span.first]++] = i / 3;
+		}
+
+		std::vector<uint32_t> timestamps(span.count, 0);
+		uint32_t time = cacheSize + 1;
+		std::vector<bool> emitted(triangleCount, false);
+		//vertices of the emitted triangles, most recent last, where fanning resumes after a dead end
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		deadEnd.reserve(triangleCount * 3);
+		output.reserve(triangleCount * 3);
+		uint32_t cursor = 0;
+		//the lowest index of the span is always referenced
+		uint32_t fanning = 0;
+		while (fanning != INVALID_VERTEX)
+		{
+			candidates.clear();
+			for (uint32_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++)
+			{
+				uint32_t triangle = adjacency[a];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				emitted[triangle] = true;
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = source[triangle * 3 + corner] - span.first;
+					output.push_back(vertex);
+					deadEnd.push_back(vertex);
+					candidates.push_back(vertex);
+					liveCount[vertex]--;
+					if (time - timestamps[vertex] > cacheSize)
+					{
+						timestamps[vertex] = time++;
+					}
+				}
+			}
+
+			//the candidate that will still be cached once its remaining triangles are emitted, the oldest one wins.
+			//the rest score 0 and never win, they are left to the dead-end stack
+			fanning = INVALID_VERTEX;
+			int64_t bestPriority = 0;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveCount[vertex] == 0)
+				{
+					continue;
+				}
+				int64_t priority = 0;
+				if (time - timestamps[vertex] + 2 * liveCount[vertex] <= cacheSize)
+				{
+					priority = time - timestamps[vertex];
+				}
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					fanning = vertex;
+				}
+			}
+			while (fanning == INVALID_VERTEX && !deadEnd.empty())
+			{
+				uint32_t vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveCount[vertex] > 0)
+				{
+					fanning = vertex;
+				}
+			}
+			//nothing local left, continue with the next unfinished vertex in index order
+			for (; fanning == INVALID_VERTEX && cursor < span.count; cursor++)
+			{
+				if (liveCount[cursor] > 0)
+				{
+					fanning = cursor;
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			indices[startIndex + i] = output[i] + span.first;
+		}
+	}
+
+	void optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount,
+		float threshold, uint32_t cacheSize)
+	{
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+		{
+			return;
+		}
+		VertexSpan span = vertexSpan(indices, startIndex, triangleCount * 3);
+		const uint32_t* source = indices.data() + startIndex;
+		VertexCache cache(span.count, cacheSize);
+
+		//hard boundaries where the cache ran dry and every vertex of the triangle missed
+		std::vector<uint32_t> hardBoundaries;
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			if (cache.access(source + triangle * 3, span.first) == 3)
+			{
+				hardBoundaries.push_back(triangle);
+			}
+		}
+		hardBoundaries.push_back(triangleCount);
+
+		//soft boundaries inside each hard cluster, wherever the piece so far stays within threshold of the
+		//cluster's ACMR. every piece starts from a cold cache since its neighbours change once sorted
+		std::vector<Cluster> clusters;
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+		{
+			uint32_t begin = hardBoundaries[h];
+			uint32_t end = hardBoundaries[h + 1];
+			cache.flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t triangle = begin; triangle < end; triangle++)
+			{
+				clusterMisses += cache.access(source + triangle * 3, span.first);
+			}
+			float missLimit = threshold * clusterMisses / (end - begin);
+			cache.flush();
+			uint32_t pieceBegin = begin;
+			uint32_t pieceMisses = 0;
+			for (uint32_t triangle = begin; triangle < end; triangle++)
+			{
+				pieceMisses += cache.access(source + triangle * 3, span.first);
+				uint32_t pieceTriangles = triangle + 1 - pieceBegin;
+				if (triangle + 1 == end || pieceMisses <= missLimit * pieceTriangles)
+				{
+					clusters.push_back(Cluster{ pieceBegin, pieceTriangles, 0.0f });
+					pieceBegin = triangle + 1;
+					pieceMisses = 0;
+					cache.flush();
+				}
+			}
+		}
+		if (clusters.size() < 2)
+		{
+			return;
+		}
+
+		//area weighted centroid of the surface and of each cluster
+		std::vector<glm::vec3> clusterCentroids(clusters.size());
+		std::vector<glm::vec3> clusterNormals(clusters.size());
+		glm::vec3 centroid{ 0.0f };
+		float area = 0.0f;
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			glm::vec3 clusterCentroid{ 0.0f };
+			glm::vec3 clusterNormal{ 0.0f };
+			float clusterArea = 0.0f;
+			for (uint32_t triangle = clusters[c].firstTriangle; triangle < clusters[c].firstTriangle + clusters[c].triangleCount; triangle++)
+			{
+				glm::vec3 a = vertices[source[triangle * 3 + 0]].position;
+				glm::vec3 b = vertices[source[triangle * 3 + 1]].position;
+				glm::vec3 d = vertices[source[triangle * 3 + 2]].position;
+				glm::vec3 normal = glm::cross(b - a, d - a);
+				float weight = glm::length(normal);
+				clusterCentroid += (a + b + d) * (weight / 3.0f);
+				clusterNormal += normal;
+				clusterArea += weight;
+			}
+			centroid += clusterCentroid;
+			area += clusterArea;
+			clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroid / clusterArea : clusterCentroid;
+			float normalLength = glm::length(clusterNormal);
+			clusterNormals[c] = normalLength > 0.0f ? clusterNormal / normalLength : clusterNormal;
+		}
+		if (area <= 0.0f)
+		{
+			return;
+		}
+		centroid /= area;
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			clusters[c].sortKey = glm::dot(clusterCentroids[c] - centroid, clusterNormals[c]);
+		}
+		//outward facing clusters first, ties keep the cache order
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> reordered;
+		reordered.reserve(triangleCount * 3);
+		for (const Cluster& cluster : clusters)
+		{
+			reordered.insert(reordered.end(), source + cluster.firstTriangle * 3, source + (cluster.firstTriangle + cluster.triangleCount) * 3);
+		}
+		std::copy(reordered.begin(), reordered.end(), indices.begin() + startIndex);
+	}
+
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, uint32_t firstVertex, uint32_t vertexCount,
+		std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, INVALID_VERTEX);
+		uint32_t next = 0;
+		for (uint32_t i = startIndex; i < startIndex + indexCount; i++)
+		{
+			uint32_t& target = remap[indices[i] - firstVertex];
+			if (target == INVALID_VERTEX)
+			{
+				target = next++;
+			}
+			indices[i] = firstVertex + target;
+		}
+		std::vector<Vertex> reordered(vertexCount);
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			if (remap[vertex] == INVALID_VERTEX)
+			{
+				remap[vertex] = next++;
+			}
+			reordered[remap[vertex]] = vertices[firstVertex + vertex];
+		}
+		std::copy(reordered.begin(), reordered.end(), vertices.begin() + firstVertex);
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include "../type.h"
+
+//load time triangle and vertex reordering of one surface, [startIndex, startIndex + indexCount) of indices.
+//run before the meshlets are built so they inherit the order
+namespace MeshOptimizer
+{
+	//post transform cache modelled as a FIFO of this many vertices
+	constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+	//clusters may lose this much cache efficiency for a better overdraw order
+	constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	//vertices transformed when the triangles go through the FIFO cache in index order, divided by the
+	//triangle count it is the ACMR
+	uint32_t simulateVertexCache(const std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+	//Tipsify: fans the triangles around each vertex in turn, preferring the next vertex still in the cache
+	void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+	//splits the cache ordered triangles into clusters and draws the ones facing away from the surface center
+	//first, they are the most likely to occlude the rest
+	void optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount,
+		float threshold = OVERDRAW_THRESHOLD, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+	//renumbers [firstVertex, firstVertex + vertexCount) in the order the indices first use them,
+	//vertices the surface never references move behind the used ones
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, uint32_t firstVertex, uint32_t vertexCount,
+		std::vector<uint32_t>& indices, uint32_t startIndex, uint32_t indexCount);
+}
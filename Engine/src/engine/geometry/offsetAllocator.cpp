@@ -0,0 +1,94 @@
+#include "offsetAllocator.h"
+#include "core.h"
+
+void OffsetAllocator::init(uint32_t capacity)
+{
+	mCapacity = capacity;
+	reset();
+}
+
+void OffsetAllocator::reset()
+{
+	mFreeByOffset.clear();
+	mFreeBySize.clear();
+	mFreeSize = 0;
+	if (mCapacity > 0)
+	{
+		insertFree(0, mCapacity);
+	}
+}
+
+void OffsetAllocator::insertFree(uint32_t offset, uint32_t size)
+{
+	mFreeByOffset.emplace(offset, size);
+	mFreeBySize.emplace(size, offset);
+	mFreeSize += size;
+}
+
+void OffsetAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator iter)
+{
+	auto range = mFreeBySize.equal_range(iter->second);
+	for (auto sizeIter = range.first; sizeIter != range.second; sizeIter++)
+	{
+		if (sizeIter->second == iter->first)
+		{
+			mFreeBySize.erase(sizeIter);
+			break;
+		}
+	}
+	mFreeSize -= iter->second;
+	mFreeByOffset.erase(iter);
+}
+
+uint32_t OffsetAllocator::allocate(uint32_t size)
+{
+	if (size == 0)
+	{
+		return INVALID_OFFSET;
+	}
+	auto sizeIter = mFreeBySize.lower_bound(size);
+	if (sizeIter == mFreeBySize.end())
+	{
+		return INVALID_OFFSET;
+	}
+	uint32_t offset = sizeIter->second;
+	uint32_t freeRangeSize = sizeIter->first;
+	eraseFree(mFreeByOffset.find(offset));
+	if (freeRangeSize > size)
+	{
+		insertFree(offset + size, freeRangeSize - size);
+	}
+	return offset;
+}
+
+void OffsetAllocator::free(uint32_t offset, uint32_t size)
+{
+	if (size == 0 || offset == INVALID_OFFSET)
+	{
+		return;
+	}
+	KS_CORE_ASSERT(offset + size <= mCapacity, "OffsetAllocator: freeing a range outside the allocator");
+	auto next = mFreeByOffset.lower_bound(offset);
+	if (next != mFreeByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		eraseFree(next);
+	}
+	auto prev = mFreeByOffset.lower_bound(offset);
+	if (prev != mFreeByOffset.begin())
+	{
+		prev--;
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			eraseFree(prev);
+		}
+	}
+	insertFree(offset, size);
+}
+
+uint32_t OffsetAllocator::largestFreeRange() const
+{
+	return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <map>
+
+//best fit range allocator over [0, capacity) in abstract units, free ranges are coalesced
+class OffsetAllocator
+{
+public:
+	static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+public:
+	void init(uint32_t capacity);
+	//INVALID_OFFSET when no free range is large enough
+	uint32_t allocate(uint32_t size);
+	void free(uint32_t offset, uint32_t size);
+	void reset();
+	uint32_t capacity() const { return mCapacity; }
+	uint32_t usedSize() const { return mCapacity - mFreeSize; }
+	uint32_t freeSize() const { return mFreeSize; }
+	uint32_t largestFreeRange() const;
+private:
+	void insertFree(uint32_t offset, uint32_t size);
+	void eraseFree(std::map<uint32_t, uint32_t>::iterator iter);
+private:
+	uint32_t						mCapacity{ 0 };
+	uint32_t						mFreeSize{ 0 };
+	//offset -> size for coalescing, size -> offset for best fit lookups
+	std::map<uint32_t, uint32_t>	mFreeByOffset;
+	std::multimap<uint32_t, uint32_t> mFreeBySize;
+};
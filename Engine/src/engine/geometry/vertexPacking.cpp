@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <gtc/packing.hpp>
+#include "vertexPacking.h"
+
+namespace
+{
+	uint16_t packSnorm8x2(glm::vec2 value)
+	{
+		glm::vec2 clamped = glm::clamp(value, glm::vec2(-1.0f), glm::vec2(1.0f));
+		auto toByte = [](float v) { return static_cast<uint16_t>(static_cast<uint8_t>(static_cast<int8_t>(std::lround(v * 127.0f)))); };
+		return static_cast<uint16_t>(toByte(clamped.x) | toByte(clamped.y) << 8);
+	}
+}
+
+namespace VertexPacking
+{
+	VertexQuantization computeQuantization(const std::vector<Vertex>& vertices)
+	{
+		VertexQuantization quantization;
+		if (vertices.empty())
+		{
+			return quantization;
+		}
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (const Vertex& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		quantization.offset = boundsMin;
+		quantization.scale = boundsMax - boundsMin;
+		return quantization;
+	}
+
+	glm::vec2 octEncode(glm::vec3 direction)
+	{
+		float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		if (length <= std::numeric_limits<float>::epsilon())
+		{
+			return glm::vec2(0.0f);
+		}
+		direction /= length;
+		if (direction.z >= 0.0f)
+		{
+			return glm::vec2(direction.x, direction.y);
+		}
+		//fold the lower hemisphere over the diagonals
+		return glm::vec2((1.0f - std::abs(direction.y)) * (direction.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(direction.x)) * (direction.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	PackedVertex pack(const Vertex& vertex, const VertexQuantization& quantization)
+	{
+		PackedVertex packed;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = quantization.scale[axis];
+			float unorm = extent > 0.0f ? (vertex.position[axis] - quantization.offset[axis]) / extent : 0.0f;
+			packed.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(unorm, 0.0f, 1.0f) * 65535.0f));
+		}
+		packed.flags = vertex.tangent.w < 0.0f ? 1 : 0;
+		packed.normalTangent = packSnorm8x2(octEncode(vertex.normal)) | static_cast<uint32_t>(packSnorm8x2(octEncode(glm::vec3(vertex.tangent)))) << 16;
+		packed.uv = glm::packHalf2x16(vertex.uv);
+		return packed;
+	}
+
+	void packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& packed)
+	{
+		packed.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			packed[i] = pack(vertices[i], quantization);
+		}
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "../type.h"
+
+//encodes loader vertices into the 16 byte PackedVertex layout of the geometry buffer
+namespace VertexPacking
+{
+	//bounds of the positions, every axis gets the full unorm16 range
+	VertexQuantization computeQuantization(const std::vector<Vertex>& vertices);
+	PackedVertex pack(const Vertex& vertex, const VertexQuantization& quantization);
+	void packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& packed);
+	//unit vector onto the [-1, 1] square of the octahedral mapping
+	glm::vec2 octEncode(glm::vec3 direction);
+}
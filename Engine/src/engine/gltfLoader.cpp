@@ -1,13 +1,17 @@
+#include <limits>
 #include <fastgltf/core.hpp>
 #include <glm.hpp>
 #include <fastgltf/glm_element_traits.hpp>
 #include <fastgltf/tools.hpp>
 #include "gltfLoader.h"
+#include "geometry/meshOptimizer.h"
 #include "core.h"
 #include "../engine/kEngine.h"
+#include "profiler/cpuProfiler.h"
 
-std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, const std::filesystem::path& path)
+std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, const std::filesystem::path& path, bool optimizeMeshes)
 {
+	KS_PROFILE_FUNCTION();
 	std::vector<std::shared_ptr<MeshAssert>> res;
 	auto dataBuffer = fastgltf::GltfDataBuffer::FromPath(path);
 	if (dataBuffer.error() != fastgltf::Error::None)
@@ -29,12 +33,16 @@ std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, co
 	std::vector<std::shared_ptr<MeshAssert>> meshes;
 	std::vector<uint32_t> indices;
 	std::vector<Vertex> vertices;
+	std::vector<uint32_t> meshletData;
 	for (auto& mesh : assert.meshes)
 	{
 		auto meshAssert = std::make_shared<MeshAssert>();
 		meshAssert->name = mesh.name.empty() ? "unknown name" : mesh.name;
 		indices.clear();
 		vertices.clear();
+		meshletData.clear();
+		uint32_t missesBefore = 0;
+		uint32_t missesAfter = 0;
 		for (auto& primative : mesh.primitives)
 		{
 			auto& indexAccessor = assert.accessors[primative.indicesAccessor.value()];
@@ -57,15 +65,68 @@ std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, co
 				vertices.resize(vertices.size() + posAccessor.count);
 				fastgltf::iterateAccessorWithIndex<glm::vec3>(assert, posAccessor, [&](glm::vec3 pos, size_t index) {
 					Vertex vertex{};
-					vertex.position = { pos , 1.0 };
-					vertex.color = { 1.0, 0.0, 0.0, 1.0 };
+					vertex.position = pos;
+					vertex.normal = { 0.0f, 0.0f, 1.0f };
+					vertex.tangent = { 1.0f, 0.0f, 0.0f, 1.0f };
+					vertex.uv = { 0.0f, 0.0f };
 					vertices[initialVtx + index] = vertex;
 				});
 			}
 
+			//optional attributes, the defaults above stay when missing
+			auto normals = primative.findAttribute("NORMAL");
+			if (normals != primative.attributes.end())
+			{
+				fastgltf::iterateAccessorWithIndex<glm::vec3>(assert, assert.accessors[normals->accessorIndex], [&](glm::vec3 normal, size_t index) {
+					vertices[initialVtx + index].normal = normal;
+				});
+			}
+			auto tangents = primative.findAttribute("TANGENT");
+			if (tangents != primative.attributes.end())
+			{
+				fastgltf::iterateAccessorWithIndex<glm::vec4>(assert, assert.accessors[tangents->accessorIndex], [&](glm::vec4 tangent, size_t index) {
+					vertices[initialVtx + index].tangent = tangent;
+				});
+			}
+			auto uvs = primative.findAttribute("TEXCOORD_0");
+			if (uvs != primative.attributes.end())
+			{
+				fastgltf::iterateAccessorWithIndex<glm::vec2>(assert, assert.accessors[uvs->accessorIndex], [&](glm::vec2 uv, size_t index) {
+					vertices[initialVtx + index].uv = uv;
+				});
+			}
+
+			//triangles in vertex cache then overdraw order, vertices in the order they are fetched
+			if (optimizeMeshes)
+			{
+				missesBefore += MeshOptimizer::simulateVertexCache(indices, newSurface.startIndex, newSurface.indexCount);
+				MeshOptimizer::optimizeVertexCache(indices, newSurface.startIndex, newSurface.indexCount);
+				MeshOptimizer::optimizeOverdraw(vertices, indices, newSurface.startIndex, newSurface.indexCount);
+				MeshOptimizer::optimizeVertexFetch(vertices, static_cast<uint32_t>(initialVtx), static_cast<uint32_t>(vertices.size() - initialVtx),
+					indices, newSurface.startIndex, newSurface.indexCount);
+				missesAfter += MeshOptimizer::simulateVertexCache(indices, newSurface.startIndex, newSurface.indexCount);
+			}
+
+			newSurface.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			newSurface.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (uint32_t i = newSurface.startIndex; i < newSurface.startIndex + newSurface.indexCount; i++)
+			{
+				glm::vec3 position = vertices[indices[i]].position;
+				newSurface.boundsMin = glm::min(newSurface.boundsMin, position);
+				newSurface.boundsMax = glm::max(newSurface.boundsMax, position);
+			}
+			newSurface.firstMeshlet = static_cast<uint32_t>(meshAssert->meshlets.size());
+			buildMeshlets(vertices, indices, newSurface.startIndex, newSurface.indexCount, meshAssert->meshlets, meshletData);
+			newSurface.meshletCount = static_cast<uint32_t>(meshAssert->meshlets.size()) - newSurface.firstMeshlet;
 			meshAssert->surfaces.push_back(newSurface);
 		}
-		meshAssert->meshBuffer = engine->loadMeshBuffer(vertices, indices);
+		if (optimizeMeshes && indices.size() >= 3)
+		{
+			float triangleCount = static_cast<float>(indices.size() / 3);
+			KS_CORE_INFO("Mesh {}: ACMR {:.3f} -> {:.3f}, {} triangles, {} vertices", meshAssert->name,
+				missesBefore / triangleCount, missesAfter / triangleCount, indices.size() / 3, vertices.size());
+		}
+		meshAssert->meshBuffer = engine->loadMeshBuffer(vertices, indices, meshletData);
 		res.push_back(meshAssert);
 	}
 	return res;
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <vector>
 #include "type.h"
+#include "culling/meshletBuilder.h"
 
 class KEngine;
 
@@ -10,13 +11,22 @@ struct GeoSurface
 {
 	uint32_t startIndex;
 	uint32_t indexCount;
+	//object space bounds of the vertices the surface references
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	//range in MeshAssert::meshlets
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
 };
 
 struct MeshAssert
 {
 	std::string name;
 	std::vector<GeoSurface> surfaces;
+	//offsets are into the meshlet stream uploaded behind the mesh's indices, see MeshBuffer::meshletDataOffset
+	std::vector<Meshlet> meshlets;
 	MeshBuffer meshBuffer;
 };
 
-std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, const std::filesystem::path& path);
\ No newline at end of file
+//optimizeMeshes reorders every surface for the vertex cache and overdraw and logs the ACMR per mesh
+std::vector<std::shared_ptr<MeshAssert>> LoadGltfMeshAsserts(KEngine* engine, const std::filesystem::path& path, bool optimizeMeshes);
\ No newline at end of file
@@ -4,21 +4,40 @@
 #include <SDL3/SDL_vulkan.h>
 #include <gtc/matrix_transform.hpp>
 #include <chrono>
+#include <algorithm>
+#include <filesystem>
 #include "core.h"
 #include "kEngine.h"
 #include "vkInitializer.h"
 #include "vkImage.h"
 #include "utils.h"
+#include "profiler/cpuProfiler.h"
+#include "geometry/vertexPacking.h"
 
 constexpr static bool useValidationLayer = true;
+static_assert(sizeof(BackGroundPushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
+static_assert(sizeof(DrawPushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
+static_assert(sizeof(DrawCommandPushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
+static_assert(sizeof(MeshletCullPushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
+static_assert(sizeof(MeshletDrawPushConstants) <= BINDLESS_PUSH_CONSTANT_SIZE, "push constants exceed the shared range");
 KEngine* kEngine = nullptr;
 
 KEngine::KEngine(uint width, uint height)
 {
+	mConfig.width = width;
+	mConfig.height = height;
 	mWindowExtent.width = width;	
 	mWindowExtent.height = height;
 }
 
+KEngine::KEngine(const EngineConfig& config)
+	:mConfig(config)
+{
+	mWindowExtent.width = config.width;
+	mWindowExtent.height = config.height;
+	mFramesInFlight = std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+}
+
 KEngine::~KEngine()
 {
 }
@@ -26,14 +45,26 @@ KEngine::~KEngine()
 void KEngine::init()
 {
 	KS_CORE_ASSERT(kEngine == nullptr, "Engine already initialized");
-	initWindow();
+	KS_PROFILE_THREAD("main");
+	KS_PROFILE_FUNCTION();
+	if (!mConfig.headless)
+	{
+		initWindow();
+	}
 	initVulkan();
-	initSwapChain();
+	if (!mConfig.headless)
+	{
+		initSwapChain();
+	}
+	initDrawImages();
 	initCommand();
-	initImmediateCommand();
+	initUploadManager();
+	initGeometryBuffer();
+	initScene();
 	initSyncStructures();
-	initDescriptorSetLayout();
-	initDescriptorSet();
+	initProfiler();
+	initBindlessHeap();
+	initShaders();
 	initPipeline();
 	initDefaultData();
 	kEngine = this;
@@ -45,13 +76,30 @@ void KEngine::cleanUp()
 	if (mInitialized)
 	{
 		vkDeviceWaitIdle(mDevice);
-		for (size_t i = 0; i < FRAME_OVERLAP; i++)
+		if (!mConfig.cpuTracePath.empty())
+		{
+			CpuProfiler::exportChromeTrace(mConfig.cpuTracePath.c_str());
+		}
+		mGpuProfiler.collectAll(mDevice);
+		mGpuProfiler.logStatistics();
+		if (!mConfig.gpuTracePath.empty())
+		{
+			mGpuProfiler.exportChromeTrace(mConfig.gpuTracePath.c_str());
+		}
+		mGpuProfiler.destroy(mDevice);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			vkDestroyCommandPool(mDevice, mFrameData[i].commandPool, nullptr);
-			vkDestroyFence(mDevice, mFrameData[i].vkFence, nullptr);	
+			if (mFrameData[i].computeCommandPool)
+			{
+				vkDestroyCommandPool(mDevice, mFrameData[i].computeCommandPool, nullptr);
+			}
 			vkDestroySemaphore(mDevice, mFrameData[i].swapchainSemaphore, nullptr);
+			resolveReadbacks(mFrameData[i]);
 			mFrameData[i].deletionQueue.flush();
 		}
+		vkDestroySemaphore(mDevice, mFrameTimeline, nullptr);
+		vkDestroySemaphore(mDevice, mComputeTimeline, nullptr);
 
 		for (size_t i = 0; i < mSwapChainImageCount; i++)
 		{
@@ -60,12 +108,22 @@ void KEngine::cleanUp()
 
 		mMainDeletionQueue.flush();
 
-		destroySwapChain();
+		if (!mConfig.headless)
+		{
+			destroyRetiredSwapChains(true);
+			destroySwapChain();
+		}
 		vkDestroyDevice(mDevice, nullptr);
-		vkDestroySurfaceKHR(mVkInstance, mVkSurface, nullptr);
+		if (!mConfig.headless)
+		{
+			vkDestroySurfaceKHR(mVkInstance, mVkSurface, nullptr);
+		}
 		vkb::destroy_debug_utils_messenger(mVkInstance, mDebugMessage);
 		vkDestroyInstance(mVkInstance, nullptr);
-		SDL_DestroyWindow(mWindow);
+		if (!mConfig.headless)
+		{
+			SDL_DestroyWindow(mWindow);
+		}
 		kEngine = nullptr;
 		mInitialized = false;
 	}
@@ -73,6 +131,12 @@ void KEngine::cleanUp()
 
 void KEngine::run()
 {
+	if (mConfig.headless)
+	{
+		runHeadless();
+		return;
+	}
+
 	SDL_Event e;
 	bool quit = false;
 	while (!quit)
@@ -91,6 +155,10 @@ void KEngine::run()
 			{
 				mStopRendering = false;
 			}
+			if (e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED)
+			{
+				mResizeRequested = true;
+			}
 		}
 		if (mStopRendering)
 		{
@@ -101,42 +169,287 @@ void KEngine::run()
 	}
 }
 
+void KEngine::runHeadless()
+{
+	//captures and benchmarks should see the whole scene from the first frame
+	mUploadManager.wait(mUploadManager.flush());
+	mPipelines.compilePending();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint i = 0; i < mConfig.headlessFrames; i++)
+	{
+		draw();
+	}
+	vkDeviceWaitIdle(mDevice);
+	auto end = std::chrono::high_resolution_clock::now();
+	double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+	KS_CORE_INFO("Headless: rendered {} frames in {:.3f} ms ({:.3f} ms/frame)", mConfig.headlessFrames, totalMs, totalMs / std::max(mConfig.headlessFrames, 1u));
+}
+
 void KEngine::draw()
 {
-	//wait lastFrame commandBuffer finish
-	VK_CHECK(vkWaitForFences(mDevice, 1, &currentFrame().vkFence, true, UINT64_MAX));
-	VK_CHECK(vkResetFences(mDevice, 1, &currentFrame().vkFence));
+	KS_PROFILE_FRAME(mFrameCounter);
+	KS_PROFILE_FUNCTION();
+	//wait until the gpu finished the last submission that used this frame
+	waitForFrame(currentFrame());
+	destroyRetiredSwapChains(false);
+	//submit staged uploads and pick up finished ones without blocking
+	mUploadManager.update();
+	mFrameUploadValue = mUploadManager.completedValue();
 
 	//get swapchain image
-	uint swapchainImageIndex;
-	VkAcquireNextImageInfoKHR acquireInfo{};
-	acquireInfo.deviceMask = 1;
-	acquireInfo.pNext = nullptr;
-	acquireInfo.semaphore = currentFrame().swapchainSemaphore;
-	acquireInfo.sType = VK_STRUCTURE_TYPE_ACQUIRE_NEXT_IMAGE_INFO_KHR;
-	acquireInfo.swapchain = mVkSwapChain;
-	acquireInfo.timeout = UINT64_MAX;
-	VK_CHECK(vkAcquireNextImage2KHR(mDevice, &acquireInfo, &swapchainImageIndex));
+	uint swapchainImageIndex = 0;
+	if (!mConfig.headless)
+	{
+		if (mResizeRequested)
+		{
+			recreateSwapChain();
+			if (mResizeRequested)
+			{
+				return;
+			}
+		}
+		VkAcquireNextImageInfoKHR acquireInfo{};
+		acquireInfo.deviceMask = 1;
+		acquireInfo.pNext = nullptr;
+		acquireInfo.semaphore = currentFrame().swapchainSemaphore;
+		acquireInfo.sType = VK_STRUCTURE_TYPE_ACQUIRE_NEXT_IMAGE_INFO_KHR;
+		acquireInfo.swapchain = mVkSwapChain;
+		acquireInfo.timeout = UINT64_MAX;
+		VkResult acquireRes;
+		{
+			KS_PROFILE_ZONE("acquire");
+			acquireRes = vkAcquireNextImage2KHR(mDevice, &acquireInfo, &swapchainImageIndex);
+		}
+		if (acquireRes == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			//nothing was signaled, retry with a new swapchain next frame
+			mResizeRequested = true;
+			return;
+		}
+		if (acquireRes == VK_SUBOPTIMAL_KHR)
+		{
+			//the image is still presentable, render this frame and recreate afterwards
+			mResizeRequested = true;
+		}
+		else
+		{
+			VK_CHECK(acquireRes);
+		}
+	}
 
 	VK_CHECK(vkResetCommandBuffer(currentFrame().commandBuffer, 0));
 	VkCommandBufferBeginInfo beginInfo = VkInitializer::createCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 	VK_CHECK(vkBeginCommandBuffer(currentFrame().commandBuffer, &beginInfo));
-	vkutil::transitionImage(currentFrame().commandBuffer, mDrawColorImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-	drawBackground();
-	vkutil::transitionImage(currentFrame().commandBuffer, mDrawColorImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	drawGeometry();
-	vkutil::transitionImage(currentFrame().commandBuffer, mDrawColorImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	vkutil::transitionImage(currentFrame().commandBuffer, mSwapChainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	vkutil::blitImage(currentFrame().commandBuffer, mDrawColorImage.image, mSwapChainImages[swapchainImageIndex], mDrawColorImage.extent, mDrawColorImage.extent);
-	vkutil::transitionImage(currentFrame().commandBuffer, mSwapChainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	mGpuProfiler.beginFrame(mDevice, currentFrame().commandBuffer, currentFrameIndex(), mFrameCounter);
+	uint32_t frameScope = mGpuProfiler.beginScope(currentFrame().commandBuffer, "frame");
+	VkCommandBuffer cmd = currentFrame().commandBuffer;
+	VkCommandBuffer computeCmd = currentFrame().computeCommandBuffer;
+	//the heap stays bound for the whole frame, pipelines all share its layout
+	mBindlessHeap.bind(cmd);
+	updateGeometryBuffer(cmd);
+	VkBuffer retiredObjects = mScene.update(mFrameUploadValue, currentFrame().deletionQueue);
+	if (retiredObjects)
+	{
+		mRenderGraph.forgetBuffer(retiredObjects);
+	}
+	updateShaders();
+	//the graphics submission at the end of draw() signals the next frame timeline value
+	mRenderGraph.reset(mFrameTimelineValue + 1);
+	RGResource drawColor = mRenderGraph.importImage("drawColor", mDrawColorImage.image, VK_IMAGE_ASPECT_COLOR_BIT, true);
+	//depth never outlives the frame, the graph places it in transient memory at the draw image size
+	RGResource drawDepth = mRenderGraph.createImage("drawDepth", RGImageDesc{ mDrawDepthFormat, mDrawColorImage.extent, VK_IMAGE_ASPECT_DEPTH_BIT });
+	mRenderGraph.addPass("background", [this](VkCommandBuffer cmd) { drawBackground(cmd); })
+		.write(drawColor, RGUsage::ComputeStorageWrite)
+		.async();
+	if (mScene.objectCount() == 0)
+	{
+		mRenderGraph.addPass("geometry", [this, drawDepth](VkCommandBuffer cmd) { drawGeometry(cmd, mRenderGraph.getImageView(drawDepth), VK_ATTACHMENT_LOAD_OP_CLEAR); })
+			.modify(drawColor, RGUsage::ColorAttachment)
+			.write(drawDepth, RGUsage::DepthAttachment);
+	}
+	else
+	{
+		RGResource objects = mRenderGraph.importBuffer("objects", mScene.objectBuffer());
+		RGResource drawCommands = mRenderGraph.importBuffer("drawCommands", mScene.commandBuffer());
+		RGResource drawCount = mRenderGraph.importBuffer("drawCount", mScene.countBuffer());
+		RGResource visibility = mRenderGraph.importBuffer("visibility", mScene.visibilityBuffer());
+		RGResource selection = mRenderGraph.importBuffer("selection", mScene.selectionBuffer());
+		RGResource cullView = mRenderGraph.importBuffer("cullView", mScene.viewBuffer());
+		RGResource meshletIndices = 0;
+		RGResource depthPyramid = 0;
+		if (mConfig.meshletCulling)
+		{
+			if (!drawMeshTasks())
+			{
+				meshletIndices = mRenderGraph.importBuffer("meshletIndices", mScene.meshletIndexBuffer());
+			}
+			mRenderGraph.addPass("updateCullView", [this](VkCommandBuffer cmd) { updateCullView(cmd); })
+				.write(cullView, RGUsage::TransferDst);
+		}
+		auto addCullPass = [&](const char* name, CullPhase phase) {
+			mRenderGraph.addPass("clearDrawCount", [this](VkCommandBuffer cmd) { vkCmdFillBuffer(cmd, mScene.countBuffer(), 0, VK_WHOLE_SIZE, 0); })
+				.write(drawCount, RGUsage::TransferDst);
+			//whole object draws, with meshlet culling only for the objects whose meshlets did not fit
+			RenderGraph::Pass& objectPass = mRenderGraph.addPass(name, [this, phase](VkCommandBuffer cmd) { generateDrawCommands(cmd, phase); })
+				.read(objects, RGUsage::ComputeStorageRead)
+				.write(drawCommands, RGUsage::ComputeStorageWrite)
+				.modify(drawCount, RGUsage::ComputeStorageReadWrite);
+			if (phase == CullPhase::Early)
+			{
+				objectPass.read(visibility, RGUsage::ComputeStorageRead);
+			}
+			else if (phase == CullPhase::Late)
+			{
+				objectPass.modify(visibility, RGUsage::ComputeStorageReadWrite)
+					.read(depthPyramid, RGUsage::ComputeSampledGeneral);
+			}
+			if (!mConfig.meshletCulling)
+			{
+				return;
+			}
+			//the objects that passed go on to per meshlet tests, the task shader runs them itself
+			objectPass.write(selection, RGUsage::ComputeStorageWrite);
+			if (drawMeshTasks())
+			{
+				return;
+			}
+			mRenderGraph.addPass("meshletCull", [this](VkCommandBuffer cmd) { cullMeshlets(cmd); })
+				.read(objects, RGUsage::ComputeStorageRead)
+				.read(selection, RGUsage::ComputeStorageRead)
+				.read(cullView, RGUsage::ComputeStorageRead)
+				.write(meshletIndices, RGUsage::ComputeStorageWrite)
+				.write(drawCommands, RGUsage::ComputeStorageWrite)
+				.modify(drawCount, RGUsage::ComputeStorageReadWrite);
+		};
+		auto addGeometryPass = [&](const char* name, VkAttachmentLoadOp depthLoadOp) {
+			RenderGraph::Pass& geometryPass = mRenderGraph.addPass(name, [this, drawDepth, depthLoadOp](VkCommandBuffer cmd) { drawGeometry(cmd, mRenderGraph.getImageView(drawDepth), depthLoadOp); })
+				.modify(drawColor, RGUsage::ColorAttachment)
+				.modify(drawDepth, RGUsage::DepthAttachment)
+				.read(drawCommands, RGUsage::IndirectRead)
+				.read(drawCount, RGUsage::IndirectRead)
+				.read(objects, RGUsage::VertexStorageRead);
+			if (drawMeshTasks())
+			{
+				geometryPass.read(objects, RGUsage::MeshStorageRead)
+					.read(selection, RGUsage::MeshStorageRead)
+					.read(cullView, RGUsage::MeshStorageRead);
+			}
+			else if (mConfig.meshletCulling)
+			{
+				geometryPass.read(meshletIndices, RGUsage::IndexRead);
+			}
+		};
+		if (!mConfig.occlusionCulling)
+		{
+			addCullPass("drawCommands", CullPhase::FrustumOnly);
+			addGeometryPass("geometry", VK_ATTACHMENT_LOAD_OP_CLEAR);
+		}
+		else
+		{
+			//draw what was visible last frame, build the pyramid from its depth, then test everything against it
+			VkImage oldPyramid = mDepthPyramid.image();
+			if (mDepthPyramid.resize(mDrawExtent, currentFrame().deletionQueue) && oldPyramid)
+			{
+				mRenderGraph.forgetImage(oldPyramid);
+			}
+			depthPyramid = mRenderGraph.importImage("depthPyramid", mDepthPyramid.image(), VK_IMAGE_ASPECT_COLOR_BIT, true);
+			if (mScene.takeNewList())
+			{
+				//object indices changed meaning, start from nothing visible
+				mRenderGraph.addPass("clearVisibility", [this](VkCommandBuffer cmd) { vkCmdFillBuffer(cmd, mScene.visibilityBuffer(), 0, VK_WHOLE_SIZE, 0); })
+					.write(visibility, RGUsage::TransferDst);
+			}
+			addCullPass("cullEarly", CullPhase::Early);
+			addGeometryPass("geometryEarly", VK_ATTACHMENT_LOAD_OP_CLEAR);
+			mRenderGraph.addPass("depthPyramid", [this, drawDepth](VkCommandBuffer cmd) { buildDepthPyramid(cmd, mRenderGraph.getImageView(drawDepth)); })
+				.read(drawDepth, RGUsage::ComputeSampled)
+				.write(depthPyramid, RGUsage::ComputeStorageWrite);
+			addCullPass("cullLate", CullPhase::Late);
+			addGeometryPass("geometryLate", VK_ATTACHMENT_LOAD_OP_LOAD);
+		}
+	}
+	if (!mReadbackRequests.empty())
+	{
+		mRenderGraph.addPass("readback", [this](VkCommandBuffer cmd) { recordReadbacks(cmd); })
+			.read(drawColor, RGUsage::TransferSrc)
+			.sideEffect();
+	}
+	if (mConfig.headless)
+	{
+		//headless frames are consumed through the draw image itself
+		mRenderGraph.markOutput(drawColor);
+	}
+	else
+	{
+		//acquire semaphore is waited at the transfer stage, chain the layout transition to it
+		RenderGraph::ResourceState acquired;
+		acquired.writeStages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		RGResource swapchainImage = mRenderGraph.importImage("swapchain", mSwapChainImages[swapchainImageIndex], VK_IMAGE_ASPECT_COLOR_BIT, acquired);
+		mRenderGraph.addPass("blit", [this, swapchainImageIndex](VkCommandBuffer cmd) {
+				vkutil::blitImage(cmd, mDrawColorImage.image, mSwapChainImages[swapchainImageIndex], VkExtent3D{ mDrawExtent.width, mDrawExtent.height, 1 }, VkExtent3D{ mSwapChainExtent.width, mSwapChainExtent.height, 1 });
+			})
+			.read(drawColor, RGUsage::TransferSrc)
+			.write(swapchainImage, RGUsage::TransferDst);
+		mRenderGraph.setFinalUsage(swapchainImage, RGUsage::Present);
+	}
+	mRenderGraph.compile(computeCmd, currentFrame().deletionQueue);
+	//the compute command buffer is only recorded on frames with a pass on the async queue
+	if (mRenderGraph.hasAsyncWork())
+	{
+		VK_CHECK(vkResetCommandBuffer(computeCmd, 0));
+		VK_CHECK(vkBeginCommandBuffer(computeCmd, &beginInfo));
+		mBindlessHeap.bindCompute(computeCmd);
+	}
+	mRenderGraph.execute(cmd, &mGpuProfiler);
+
+	//the graphics submission waits on the compute one, so the frame timeline covers both
+	VkSemaphoreSubmitInfo waitSemaphoreInfos[3];
+	uint32_t waitCount = 0;
+	if (mFrameUploadValue > 0)
+	{
+		//already signaled so it never stalls, but it makes the copies visible to this submission
+		VkPipelineStageFlags2 uploadStages = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		if (mMeshShaders)
+		{
+			//task and mesh shaders fetch meshlets and vertices straight from the uploaded buffers
+			uploadStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+		}
+		waitSemaphoreInfos[waitCount++] = VkInitializer::createSemaphoreSubmitInfo(mUploadManager.timeline(), uploadStages, mFrameUploadValue);
+	}
+	if (mRenderGraph.hasAsyncWork())
+	{
+		VK_CHECK(vkEndCommandBuffer(computeCmd));
+		uint64_t computeValue = submitAsyncCompute(computeCmd);
+		VkPipelineStageFlags2 waitStages = mRenderGraph.asyncWaitStages();
+		waitSemaphoreInfos[waitCount++] = VkInitializer::createSemaphoreSubmitInfo(mComputeTimeline,
+			waitStages != VK_PIPELINE_STAGE_2_NONE ? waitStages : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, computeValue);
+	}
+
+	currentFrame().timelineValue = ++mFrameTimelineValue;
+	VkSemaphoreSubmitInfo timelineSignalInfo = VkInitializer::createSemaphoreSubmitInfo(mFrameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, currentFrame().timelineValue);
+	if (mConfig.headless)
+	{
+		mGpuProfiler.endScope(currentFrame().commandBuffer, frameScope);
+		VK_CHECK(vkEndCommandBuffer(currentFrame().commandBuffer));
+		VkCommandBufferSubmitInfo commandBufferInfo = VkInitializer::createCommandBufferSubmitInfo(currentFrame().commandBuffer);
+		VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, &timelineSignalInfo, 1, waitSemaphoreInfos, waitCount);
+		VK_CHECK(vkQueueSubmit2(mQueue, 1, &submitInfo, nullptr));
+		mFrameCounter++;
+		return;
+	}
+
+	mGpuProfiler.endScope(currentFrame().commandBuffer, frameScope);
 	
 	VK_CHECK(vkEndCommandBuffer(currentFrame().commandBuffer));
 	
 	VkCommandBufferSubmitInfo commandBufferInfo = VkInitializer::createCommandBufferSubmitInfo(currentFrame().commandBuffer);
-	VkSemaphoreSubmitInfo waitSemaphoreInfo = VkInitializer::createSemaphoreSubmitInfo(currentFrame().swapchainSemaphore, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-	VkSemaphoreSubmitInfo signalSemaphoreInfo = VkInitializer::createSemaphoreSubmitInfo(mSignalSemaphores[swapchainImageIndex], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-	VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, &signalSemaphoreInfo, &waitSemaphoreInfo);
-	VK_CHECK(vkQueueSubmit2(mQueue, 1, &submitInfo, currentFrame().vkFence));
+	waitSemaphoreInfos[waitCount++] = VkInitializer::createSemaphoreSubmitInfo(currentFrame().swapchainSemaphore, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+	VkSemaphoreSubmitInfo signalSemaphoreInfos[2] = {
+		VkInitializer::createSemaphoreSubmitInfo(mSignalSemaphores[swapchainImageIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT),
+		timelineSignalInfo
+	};
+	VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, signalSemaphoreInfos, 2, waitSemaphoreInfos, waitCount);
+	VK_CHECK(vkQueueSubmit2(mQueue, 1, &submitInfo, nullptr));
 
 	//present image
 	VkPresentInfoKHR presentInfo{};
@@ -147,25 +460,41 @@ void KEngine::draw()
 	presentInfo.waitSemaphoreCount = 1;
 	presentInfo.swapchainCount = 1;
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	VK_CHECK(vkQueuePresentKHR(mQueue, &presentInfo));
-	currentFrame().deletionQueue.flush();
+	VkResult presentRes;
+	{
+		KS_PROFILE_ZONE("present");
+		presentRes = vkQueuePresentKHR(mQueue, &presentInfo);
+	}
+	if (presentRes == VK_ERROR_OUT_OF_DATE_KHR || presentRes == VK_SUBOPTIMAL_KHR)
+	{
+		mResizeRequested = true;
+	}
+	else
+	{
+		VK_CHECK(presentRes);
+	}
 	mFrameCounter++;
 }
 
 void KEngine::initVulkan()
 {
+	KS_PROFILE_FUNCTION();
 	vkb::InstanceBuilder builder;
 	auto instanceRes = builder
 		.request_validation_layers(useValidationLayer)
 		.set_app_name("KEngine")
 		.set_engine_name("KEngine")
 		.require_api_version(1, 3, 0)
+		.set_headless(mConfig.headless)
 		.use_default_debug_messenger()
 		.build();
 	vkb::Instance vkbInstace = instanceRes.value();
 	mVkInstance = vkbInstace.instance;
 	mDebugMessage = vkbInstace.debug_messenger;
-	SDL_Vulkan_CreateSurface(mWindow, mVkInstance, nullptr, &mVkSurface);
+	if (!mConfig.headless)
+	{
+		SDL_Vulkan_CreateSurface(mWindow, mVkInstance, nullptr, &mVkSurface);
+	}
 
 	//vulkan 1.3 features
 	VkPhysicalDeviceVulkan13Features features13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
@@ -176,20 +505,91 @@ void KEngine::initVulkan()
 	VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
 	features12.bufferDeviceAddress = true;
 	features12.descriptorIndexing = true;
+	//bindless heap: partially filled, update after bind arrays indexed by handle
+	features12.runtimeDescriptorArray = true;
+	features12.descriptorBindingPartiallyBound = true;
+	features12.descriptorBindingUpdateUnusedWhilePending = true;
+	features12.descriptorBindingSampledImageUpdateAfterBind = true;
+	features12.descriptorBindingStorageImageUpdateAfterBind = true;
+	features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+	features12.shaderSampledImageArrayNonUniformIndexing = true;
+	features12.shaderStorageImageArrayNonUniformIndexing = true;
+	features12.shaderStorageBufferArrayNonUniformIndexing = true;
+	features12.timelineSemaphore = true;
+	features12.drawIndirectCount = true;
+	//max reduction sampler of the depth pyramid
+	features12.samplerFilterMinmax = true;
+	//more than one draw per indirect call, each carrying its object index in firstInstance
+	VkPhysicalDeviceFeatures features{};
+	features.multiDrawIndirect = true;
+	features.drawIndirectFirstInstance = true;
 
 	vkb::PhysicalDeviceSelector selector{ vkbInstace };
+	if (!mConfig.headless)
+	{
+		selector.set_surface(mVkSurface);
+	}
 	auto physicalDeviceRes = selector
-		.set_surface(mVkSurface)
+		.set_required_features(features)
 		.set_required_features_12(features12)
 		.set_required_features_13(features13)
 		.select()
 		.value();
 	mPhysicalDevice = physicalDeviceRes.physical_device;
+	//optional, the meshlets fall back to compute culling and indexed draws without it
+	if (mConfig.meshletCulling && mConfig.meshShaders)
+	{
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT };
+		meshShaderFeatures.taskShader = true;
+		meshShaderFeatures.meshShader = true;
+		mMeshShaders = physicalDeviceRes.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+			physicalDeviceRes.enable_extension_features_if_present(meshShaderFeatures);
+	}
 	vkb::DeviceBuilder deviceBuilder{ physicalDeviceRes };
 	auto deviceRes = deviceBuilder.build().value();
 	mDevice = deviceRes.device;
+	if (mMeshShaders)
+	{
+		mCmdDrawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(mDevice, "vkCmdDrawMeshTasksEXT"));
+		mMeshShaders = mCmdDrawMeshTasks != nullptr;
+	}
+	if (mConfig.meshletCulling)
+	{
+		KS_CORE_INFO("Meshlets drawn with {}", mMeshShaders ? "task and mesh shaders" : "compute culling and indexed draws");
+	}
 	mQueue = deviceRes.get_queue(vkb::QueueType::graphics).value();
 	mQueueFamilyIndex = deviceRes.get_queue_index(vkb::QueueType::graphics).value();
+	//a separate compute family lets async compute passes overlap with raster work
+	auto computeQueueRes = deviceRes.get_queue(vkb::QueueType::compute);
+	if (mConfig.asyncCompute && computeQueueRes.has_value())
+	{
+		mComputeQueue = computeQueueRes.value();
+		mComputeQueueFamilyIndex = deviceRes.get_queue_index(vkb::QueueType::compute).value();
+		KS_CORE_INFO("Async compute on queue family {}", mComputeQueueFamilyIndex);
+	}
+	else
+	{
+		mComputeQueue = mQueue;
+		mComputeQueueFamilyIndex = mQueueFamilyIndex;
+		KS_CORE_INFO("Async compute disabled, compute passes run on the graphics queue");
+	}
+	auto transferQueueRes = deviceRes.get_queue(vkb::QueueType::transfer);
+	if (transferQueueRes.has_value())
+	{
+		mTransferQueue = transferQueueRes.value();
+		mTransferQueueFamilyIndex = deviceRes.get_queue_index(vkb::QueueType::transfer).value();
+		KS_CORE_INFO("Uploads on transfer queue family {}", mTransferQueueFamilyIndex);
+	}
+	else
+	{
+		mTransferQueue = mQueue;
+		mTransferQueueFamilyIndex = mQueueFamilyIndex;
+	}
+	mMeshQueueFamilies = { mQueueFamilyIndex };
+	if (mTransferQueueFamilyIndex != mQueueFamilyIndex)
+	{
+		mMeshQueueFamilies.push_back(mTransferQueueFamilyIndex);
+	}
 
 	//vma
 	VmaAllocatorCreateInfo allocatorInfo = {};	
@@ -206,6 +606,11 @@ void KEngine::initVulkan()
 void KEngine::initSwapChain()
 {
 	mSwapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	buildSwapChain(VK_NULL_HANDLE);
+}
+
+void KEngine::buildSwapChain(VkSwapchainKHR oldSwapChain)
+{
 	vkb::SwapchainBuilder builder(mPhysicalDevice, mDevice, mVkSurface);
 	auto res = builder
 		.set_desired_extent(mWindowExtent.width, mWindowExtent.height)
@@ -213,6 +618,7 @@ void KEngine::initSwapChain()
 		.use_default_format_selection()
 		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		.set_old_swapchain(oldSwapChain)
 		.build();
 	
 	vkb::Swapchain vkbSwapChain = res.value();
@@ -221,23 +627,90 @@ void KEngine::initSwapChain()
 	mSwapChainImageViews = vkbSwapChain.get_image_views().value();
 	mSwapChainExtent = vkbSwapChain.extent;
 	mSwapChainImageCount = mSwapChainImages.size();
+}
 
-	mDrawColorImage = VkInitializer::createImage(mDevice, mMemAllocator, VkExtent3D{ mSwapChainExtent.width, mSwapChainExtent.height, 1 }, VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT);
+void KEngine::recreateSwapChain()
+{
+	KS_PROFILE_FUNCTION();
+	int width = 0;
+	int height = 0;
+	SDL_GetWindowSizeInPixels(mWindow, &width, &height);
+	if (width == 0 || height == 0)
+	{
+		//minimized, keep the request pending until the window has a size again
+		return;
+	}
+	mWindowExtent.width = width;
+	mWindowExtent.height = height;
 
-	mDrawDepthImage = VkInitializer::createImage(mDevice, mMemAllocator, VkExtent3D{ mSwapChainExtent.width, mSwapChainExtent.height, 1 }, VK_FORMAT_D32_SFLOAT,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_IMAGE_ASPECT_DEPTH_BIT);
+	//frames already submitted may still render to or present the old images, retire them by frame timeline value.
+	//the present semaphores are only waited by the presentation engine, so the old set is kept until the first
+	//frame submitted after the recreate completes, which follows every old present on the queue
+	VkSwapchainKHR oldSwapChain = mVkSwapChain;
+	mRetiredSwapChains.push_back(RetiredSwapChain{ mFrameTimelineValue + 1, oldSwapChain, mSwapChainImageViews, mSignalSemaphores });
+	buildSwapChain(oldSwapChain);
+
+	mSignalSemaphores.clear();
+	VkSemaphoreCreateInfo semaphoreInfo = VkInitializer::createSemaphoreInfo(0);
+	for (size_t i = 0; i < mSwapChainImageCount; i++)
+	{
+		VkSemaphore signalSemaphore;
+		VK_CHECK(vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &signalSemaphore));
+		mSignalSemaphores.push_back(signalSemaphore);
+	}
+
+	//draw images are allocated at a max size, only grow them when the window outgrows it
+	if (mSwapChainExtent.width > mDrawColorImage.extent.width || mSwapChainExtent.height > mDrawColorImage.extent.height)
+	{
+		waitForAllFrames();
+		destroyDrawImages();
+		createDrawImages(VkExtent2D{ std::max(mSwapChainExtent.width, mDrawColorImage.extent.width), std::max(mSwapChainExtent.height, mDrawColorImage.extent.height) });
+		writeDrawImageDescriptor();
+	}
+	mDrawExtent = mSwapChainExtent;
+	mResizeRequested = false;
+}
+
+void KEngine::initDrawImages()
+{
+	//headless mode has no swapchain, the draw images follow the requested size
+	VkExtent2D drawExtent = mConfig.headless ? mWindowExtent : mSwapChainExtent;
+	mDrawExtent = drawExtent;
+	if (!mConfig.headless)
+	{
+		//allocate for the whole display so window resizes never reallocate
+		SDL_DisplayID display = SDL_GetDisplayForWindow(mWindow);
+		const SDL_DisplayMode* mode = display ? SDL_GetDesktopDisplayMode(display) : nullptr;
+		if (mode)
+		{
+			drawExtent.width = std::max(drawExtent.width, static_cast<uint32_t>(mode->w * mode->pixel_density));
+			drawExtent.height = std::max(drawExtent.height, static_cast<uint32_t>(mode->h * mode->pixel_density));
+		}
+	}
+	createDrawImages(drawExtent);
+	mRenderGraph.init(mDevice, mMemAllocator, mQueueFamilyIndex, mComputeQueueFamilyIndex);
 
 	mMainDeletionQueue.push_back([=]() {
-		vkDestroyImageView(mDevice, mDrawColorImage.imageView, nullptr);
-		vkDestroyImageView(mDevice, mDrawDepthImage.imageView, nullptr);
-		vmaDestroyImage(mMemAllocator, mDrawColorImage.image, mDrawColorImage.allocation);
-		vmaDestroyImage(mMemAllocator, mDrawDepthImage.image, mDrawDepthImage.allocation);
+		mRenderGraph.destroy();
+		destroyDrawImages();
 	});
 }
 
+void KEngine::createDrawImages(VkExtent2D extent)
+{
+	mDrawColorImage = VkInitializer::createImage(mDevice, mMemAllocator, VkExtent3D{ extent.width, extent.height, 1 }, VK_FORMAT_R16G16B16A16_SFLOAT,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		VK_IMAGE_ASPECT_COLOR_BIT);
+	KS_CORE_INFO("Draw images allocated at {}x{}", extent.width, extent.height);
+}
+
+void KEngine::destroyDrawImages()
+{
+	mRenderGraph.forgetImage(mDrawColorImage.image);
+	vkDestroyImageView(mDevice, mDrawColorImage.imageView, nullptr);
+	vmaDestroyImage(mMemAllocator, mDrawColorImage.image, mDrawColorImage.allocation);
+}
+
 void KEngine::destroySwapChain()
 {
 	vkDestroySwapchainKHR(mDevice, mVkSwapChain, nullptr);
@@ -247,42 +720,156 @@ void KEngine::destroySwapChain()
 	}
 }
 
+void KEngine::destroyRetiredSwapChains(bool all)
+{
+	if (mRetiredSwapChains.empty())
+	{
+		return;
+	}
+	uint64_t completedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mFrameTimeline, &completedValue));
+	auto iter = std::remove_if(mRetiredSwapChains.begin(), mRetiredSwapChains.end(), [&](RetiredSwapChain& retired) {
+		if (!all && retired.frameTimelineValue > completedValue)
+		{
+			return false;
+		}
+		for (auto& imageView : retired.imageViews)
+		{
+			vkDestroyImageView(mDevice, imageView, nullptr);
+		}
+		for (auto& semaphore : retired.signalSemaphores)
+		{
+			vkDestroySemaphore(mDevice, semaphore, nullptr);
+		}
+		vkDestroySwapchainKHR(mDevice, retired.swapchain, nullptr);
+		return true;
+	});
+	mRetiredSwapChains.erase(iter, mRetiredSwapChains.end());
+}
+
 void KEngine::initCommand()
 {
 	VkCommandPoolCreateInfo poolInfo = VkInitializer::createCommandPoolInfo(mQueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 	
-	for (size_t i = 0; i < FRAME_OVERLAP; i++)
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		VK_CHECK(vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mFrameData[i].commandPool));
 		VkCommandBufferAllocateInfo commandInfo = VkInitializer::createCommandBufferInfo(mFrameData[i].commandPool);
 		VK_CHECK(vkAllocateCommandBuffers(mDevice, &commandInfo, &mFrameData[i].commandBuffer));
 	}
+	if (hasAsyncCompute())
+	{
+		VkCommandPoolCreateInfo computePoolInfo = VkInitializer::createCommandPoolInfo(mComputeQueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			VK_CHECK(vkCreateCommandPool(mDevice, &computePoolInfo, nullptr, &mFrameData[i].computeCommandPool));
+			VkCommandBufferAllocateInfo commandInfo = VkInitializer::createCommandBufferInfo(mFrameData[i].computeCommandPool);
+			VK_CHECK(vkAllocateCommandBuffers(mDevice, &commandInfo, &mFrameData[i].computeCommandBuffer));
+		}
+	}
 }
 
-void KEngine::initImmediateCommand()
+void KEngine::initGeometryBuffer()
 {
-	VkCommandPoolCreateInfo poolInfo = VkInitializer::createCommandPoolInfo(mQueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-	VK_CHECK(vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mImmediateSubmitPool));
+	mGeometryBuffer.init(mDevice, mMemAllocator, sizeof(PackedVertex), mConfig.geometryVertexCapacity, mConfig.geometryIndexCapacity, mMeshQueueFamilies);
+	mMainDeletionQueue.push_back([=]() {
+		mGeometryBuffer.destroy();
+	});
+}
 
-	VkCommandBufferAllocateInfo commandInfo = VkInitializer::createCommandBufferInfo(mImmediateSubmitPool);
-	VK_CHECK(vkAllocateCommandBuffers(mDevice, &commandInfo, &mImmediateSubmitCmd));
+void KEngine::initScene()
+{
+	//meshlets one draw can reach: task groups of MESHLET_TASK_GROUP_SIZE, or a 2D grid of one cull workgroup each
+	VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT };
+	VkPhysicalDeviceProperties2 properties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+	properties.pNext = mMeshShaders ? &meshShaderProperties : nullptr;
+	vkGetPhysicalDeviceProperties2(mPhysicalDevice, &properties);
+	const VkPhysicalDeviceLimits& limits = properties.properties.limits;
+	mMeshletDispatchWidth = limits.maxComputeWorkGroupCount[0];
+	uint64_t meshletLimit = mMeshShaders
+		? static_cast<uint64_t>(std::min(meshShaderProperties.maxTaskWorkGroupCount[0], meshShaderProperties.maxTaskWorkGroupTotalCount)) * MESHLET_TASK_GROUP_SIZE
+		: static_cast<uint64_t>(limits.maxComputeWorkGroupCount[0]) * limits.maxComputeWorkGroupCount[1];
+	uint32_t maxMeshlets = static_cast<uint32_t>(std::min<uint64_t>(mConfig.maxDrawMeshlets, meshletLimit));
+	mScene.init(mDevice, mMemAllocator, mConfig.maxDrawObjects, maxMeshlets, mConfig.meshletCulling && !mMeshShaders, mMeshQueueFamilies);
+	mMainDeletionQueue.push_back([=]() {
+		mScene.destroy();
+	});
+}
 
-	VkFenceCreateInfo fenceInfo = VkInitializer::createFenceInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-	VK_CHECK(vkCreateFence(mDevice, &fenceInfo, nullptr, &mImmediateSubmitFence));
+void KEngine::buildScene()
+{
+	KS_PROFILE_FUNCTION();
+	std::vector<GpuObject> objects;
+	std::vector<GpuMeshlet> meshlets;
+	UploadTicket geometryTicket = 0;
+	const float spacing = 3.0f;
+	//objects with 16 bit indices first, the geometry pass draws each index type with its own call
+	for (VkIndexType indexType : { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 })
+	{
+		for (size_t i = 0; i < mMeshes.size(); i++)
+		{
+			const MeshBuffer& meshBuffer = mMeshes[i]->meshBuffer;
+			if (meshBuffer.geometry.indexType != indexType)
+			{
+				continue;
+			}
+			geometryTicket = std::max(geometryTicket, meshBuffer.uploadTicket);
+			//meshes side by side along x, centered on the origin
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3{ (static_cast<float>(i) - (mMeshes.size() - 1) * 0.5f) * spacing, 0.0f, 0.0f });
+			for (const GeoSurface& surface : mMeshes[i]->surfaces)
+			{
+				GpuObject object;
+				object.model = model;
+				//an empty range (failed allocation) keeps indexCount 0 and is never drawn
+				object.firstIndex = GeometryBuffer::firstElement(meshBuffer.geometry) + surface.startIndex;
+				object.indexCount = meshBuffer.geometry.indexCount > 0 ? surface.indexCount : 0;
+				object.vertexOffset = static_cast<int32_t>(meshBuffer.geometry.vertexOffset);
+				object.flags = indexType == VK_INDEX_TYPE_UINT16 ? GPU_OBJECT_INDEX16 : 0;
+				object.boundsMin = glm::vec4(surface.boundsMin, 1.0f);
+				object.boundsMax = glm::vec4(surface.boundsMax, 1.0f);
+				object.positionOffset = glm::vec4(meshBuffer.quantization.offset, 0.0f);
+				object.positionScale = glm::vec4(meshBuffer.quantization.scale, 0.0f);
+				//an object without geometry has no meshlets either
+				uint32_t meshletData = meshBuffer.geometry.firstIndex + meshBuffer.meshletDataOffset;
+				for (uint32_t m = 0; object.indexCount > 0 && m < surface.meshletCount; m++)
+				{
+					const Meshlet& meshlet = mMeshes[i]->meshlets[surface.firstMeshlet + m];
+					GpuMeshlet gpuMeshlet;
+					gpuMeshlet.objectIndex = static_cast<uint32_t>(objects.size());
+					gpuMeshlet.vertexOffset = meshletData + meshlet.vertexOffset;
+					gpuMeshlet.triangleOffset = meshletData + meshlet.triangleOffset;
+					gpuMeshlet.counts = meshlet.vertexCount | meshlet.triangleCount << 16;
+					gpuMeshlet.sphere = glm::vec4(meshlet.center, meshlet.radius);
+					gpuMeshlet.coneApex = glm::vec4(meshlet.coneApex, 1.0f);
+					gpuMeshlet.coneAxis = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+					meshlets.push_back(gpuMeshlet);
+				}
+				objects.push_back(object);
+			}
+		}
+	}
+	mScene.setObjects(objects, meshlets, geometryTicket, mUploadManager);
+}
 
+void KEngine::initUploadManager()
+{
+	mUploadManager.init(mDevice, mMemAllocator, mTransferQueue, mTransferQueueFamilyIndex, static_cast<VkDeviceSize>(mConfig.stagingSizeMB) * 1024 * 1024);
 	mMainDeletionQueue.push_back([=]() {
-		vkDestroyCommandPool(mDevice, mImmediateSubmitPool, nullptr);
-		vkDestroyFence(mDevice, mImmediateSubmitFence, nullptr);
+		mUploadManager.destroy();
 	});
 }
 
 void KEngine::initSyncStructures()
 {
 	VkSemaphoreCreateInfo semaphoreInfo = VkInitializer::createSemaphoreInfo(0);
-	VkFenceCreateInfo fenceInfo = VkInitializer::createFenceInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-	for (size_t i = 0; i < FRAME_OVERLAP; i++)
+	VkSemaphoreTypeCreateInfo timelineTypeInfo = VkInitializer::createSemaphoreTypeInfo(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+	VkSemaphoreCreateInfo timelineInfo = VkInitializer::createSemaphoreInfo(0);
+	timelineInfo.pNext = &timelineTypeInfo;
+	VK_CHECK(vkCreateSemaphore(mDevice, &timelineInfo, nullptr, &mFrameTimeline));
+	VK_CHECK(vkCreateSemaphore(mDevice, &timelineInfo, nullptr, &mComputeTimeline));
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		VK_CHECK(vkCreateFence(mDevice, &fenceInfo, nullptr, &mFrameData[i].vkFence));
 		VK_CHECK(vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mFrameData[i].swapchainSemaphore));
 	}
 
@@ -294,300 +881,364 @@ void KEngine::initSyncStructures()
 	}
 }
 
-void KEngine::initDescriptorSetLayout()
+void KEngine::initProfiler()
 {
-	VkDescriptorSetLayoutBinding binding{};
-	binding.binding = 0;
-	binding.descriptorCount = 1;
-	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-	binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	binding.pImmutableSamplers = nullptr;
+	//one query range per frame slot, a slot's results are read when the slot is reused
+	mGpuProfiler.init(mDevice, mPhysicalDevice, mQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT);
+}
 
-	VkDescriptorSetLayoutCreateInfo info{};
-	info.bindingCount = 1;
-	info.flags = 0;
-	info.pNext = nullptr;
-	info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	info.pBindings = &binding;
-	
-	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &info, nullptr, &mComputeDescriptorSetLayout));
+void KEngine::initBindlessHeap()
+{
+	mBindlessHeap.init(mDevice, mPhysicalDevice, BindlessHeap::Capacity{});
+	mDrawColorHandle = mBindlessHeap.registerStorageImage(mDrawColorImage.imageView);
 	mMainDeletionQueue.push_back([=]() {
-		vkDestroyDescriptorSetLayout(mDevice, mComputeDescriptorSetLayout, nullptr);
+		mBindlessHeap.destroy();
 	});
+	//sized on the first frame that culls
+	mDepthPyramid.init(mDevice, mMemAllocator, &mBindlessHeap);
+	mMainDeletionQueue.push_back([=]() {
+		mDepthPyramid.destroy();
+	});
+}
+
+void KEngine::writeDrawImageDescriptor()
+{
+	//called with every frame drained, the slot is not in use
+	mBindlessHeap.updateStorageImage(mDrawColorHandle, mDrawColorImage.imageView);
 }
 
-void KEngine::initDescriptorSet()
-{
-	VkDescriptorPoolSize poolSize;
-	poolSize.descriptorCount = 1;
-	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.flags = 0;
-	poolInfo.maxSets = 1;
-	poolInfo.pNext = nullptr;
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-
-	VK_CHECK(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool));
-
-	VkDescriptorSetAllocateInfo allocateInfo{};
-	allocateInfo.descriptorPool = mDescriptorPool;
-	allocateInfo.descriptorSetCount = 1;
-	allocateInfo.pNext = nullptr;
-	allocateInfo.pSetLayouts = &mComputeDescriptorSetLayout;
-	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	vkAllocateDescriptorSets(mDevice, &allocateInfo, &mComputeDescriptorSet);
-
-	VkDescriptorImageInfo imageInfo{};
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-	imageInfo.imageView = mDrawColorImage.imageView;
-	imageInfo.sampler = VK_NULL_HANDLE;
-
-	VkWriteDescriptorSet writeDescriptorSet{};
-	writeDescriptorSet.descriptorCount = 1;
-	writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-	writeDescriptorSet.dstArrayElement = 0;
-	writeDescriptorSet.dstBinding = 0;
-	writeDescriptorSet.dstSet = mComputeDescriptorSet;
-	writeDescriptorSet.pBufferInfo = nullptr;
-	writeDescriptorSet.pImageInfo = &imageInfo;
-	writeDescriptorSet.pNext = nullptr;
-	writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	vkUpdateDescriptorSets(mDevice, 1, &writeDescriptorSet, 0, nullptr);
+void KEngine::initShaders()
+{
+	//the post build step packs the archive. hot reload runs in a dev tree, keep it in sync with shaders glslc
+	//produced since then without scanning the directory on every other startup
+	std::error_code error;
+	if (mConfig.shaderHotReload && std::filesystem::is_directory(mConfig.shaderDirectory, error) &&
+		ShaderArchive::isStale(mConfig.shaderDirectory, mConfig.shaderArchivePath))
+	{
+		ShaderArchive::pack(mConfig.shaderDirectory, mConfig.shaderArchivePath);
+	}
+	bool opened = mShaderArchive.open(mConfig.shaderArchivePath);
+	KS_CORE_ASSERT(opened, "Failed to load the shader archive");
+	mShaderModules.init(mDevice, &mShaderArchive);
 	mMainDeletionQueue.push_back([=]() {
-		vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+		mShaderModules.destroy();
+		mShaderArchive.close();
 	});
+	if (mConfig.shaderHotReload && !mConfig.headless)
+	{
+		mShaderWatcher.start(mConfig.shaderSourceDirectory, mConfig.shaderDirectory);
+		mMainDeletionQueue.push_back([=]() {
+			mShaderWatcher.stop();
+		});
+	}
+}
+
+void KEngine::updateShaders()
+{
+	if (mShaderWatcher.running())
+	{
+		mCompiledShaders.clear();
+		mShaderWatcher.poll(mCompiledShaders);
+		for (auto& compiled : mCompiledShaders)
+		{
+			std::string name = compiled.name;
+			mShaderModules.replace(name, std::move(compiled.code));
+			uint32_t count = mPipelines.rebuildUsing(name);
+			KS_CORE_INFO("Shader {} changed, rebuilding {} pipelines", name, count);
+		}
+	}
+	//pipelines recorded by frames still in flight are destroyed with this frame's deletion queue
+	mPipelines.swapRebuilt(currentFrame().deletionQueue);
+	//the replaced modules once every rebuild using them is swapped in
+	if (mShaderWatcher.running() && mPipelines.idle())
+	{
+		mShaderModules.retireSuperseded(currentFrame().deletionQueue);
+	}
 }
 
 void KEngine::initPipeline()
 {
+	KS_PROFILE_FUNCTION();
+	mPipelineCache.init(mDevice, mPhysicalDevice, mConfig.pipelineCachePath);
+	mMainDeletionQueue.push_back([=]() {
+		mPipelineCache.destroy();
+	});
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	mPipelines.init(mDevice, &mPipelineCache, &mShaderModules, hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+	mMainDeletionQueue.push_back([=]() {
+		mPipelines.destroy();
+	});
+	mComputeTuning.init(mPhysicalDevice);
 	initComputePipeline();
 	initGraphicPipeline();
 }
 
 void KEngine::initComputePipeline()
 {
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.flags = 0;
-	pipelineLayoutInfo.pNext = nullptr;
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	VkPushConstantRange rangeInfo{};
-	rangeInfo.offset = 0;
-	rangeInfo.size = sizeof(BackGroundPushConstants);
-	rangeInfo.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	
-	pipelineLayoutInfo.pPushConstantRanges = &rangeInfo;
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &mComputeDescriptorSetLayout;
-
-	VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mComputePipelineLayout));
-	VkShaderModule computeShaderModule;
-	Utils::loadShader("Engine/src/shaders/spirv/grid.comp.spirv", mDevice, &computeShaderModule);
-	VkPipelineShaderStageCreateInfo stageInfo{};
-	stageInfo.flags = 0;
-	stageInfo.module = computeShaderModule;
-	stageInfo.pName = "main";
-	stageInfo.pNext = nullptr;
-	stageInfo.pSpecializationInfo = nullptr;
-	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-
-	VkComputePipelineCreateInfo computePipelineInfo{};
-	computePipelineInfo.flags = 0;
-	computePipelineInfo.layout = mComputePipelineLayout;
-	computePipelineInfo.pNext = nullptr;
-	computePipelineInfo.stage = stageInfo;
-	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-
-	VK_CHECK(vkCreateComputePipelines(mDevice, nullptr, 1, &computePipelineInfo, nullptr, &mComputePipeline));
-
-	vkDestroyShaderModule(mDevice, computeShaderModule, nullptr);
-	mMainDeletionQueue.push_back([=]() {
-		vkDestroyPipelineLayout(mDevice, mComputePipelineLayout, nullptr);
-		vkDestroyPipeline(mDevice, mComputePipeline, nullptr);
-	});
+	ComputePipelineBuilder builder;
+	builder.setShader("grid.comp")
+		.setLayout(mBindlessHeap.pipelineLayout())
+		.setWorkgroupSize(mComputeTuning.workgroup2D(mConfig.computeWavesPerGroup))
+		.setConstant(FIRST_USER_CONSTANT_ID, std::max(mConfig.backgroundGridSize, 1u));
+	mBackgroundPipeline = mPipelines.request(builder, "grid");
+
+	ComputePipelineBuilder drawCommandBuilder;
+	drawCommandBuilder.setShader("drawCommands.comp")
+		.setLayout(mBindlessHeap.pipelineLayout())
+		.setWorkgroupSize(mComputeTuning.workgroup1D(mConfig.computeWavesPerGroup));
+	mDrawCommandPipeline = mPipelines.request(drawCommandBuilder, "drawCommands");
+
+	ComputePipelineBuilder depthReduceBuilder;
+	depthReduceBuilder.setShader("depthReduce.comp")
+		.setLayout(mBindlessHeap.pipelineLayout())
+		.setWorkgroupSize(mComputeTuning.workgroup2D(mConfig.computeWavesPerGroup));
+	mDepthReducePipeline = mPipelines.request(depthReduceBuilder, "depthReduce");
+
+	//the cull shader maps one invocation to one triangle of the meshlet, so the group size is fixed
+	ComputePipelineBuilder meshletCullBuilder;
+	meshletCullBuilder.setShader("meshletCull.comp")
+		.setLayout(mBindlessHeap.pipelineLayout())
+		.setWorkgroupSize(VkExtent3D{ MESHLET_MAX_TRIANGLES, 1, 1 });
+	mMeshletCullPipeline = mPipelines.request(meshletCullBuilder, "meshletCull");
 }
 
 void KEngine::initGraphicPipeline()
 {
-	VkPipelineShaderStageCreateInfo vertexStages[2] = { {}, {} };
-	VkShaderModule vertexShaderModule;
-	Utils::loadShader("Engine/src/shaders/spirv/rect.vert.spirv", mDevice, &vertexShaderModule);
-	vertexStages[0].flags = 0;
-	vertexStages[0].module = vertexShaderModule;
-	vertexStages[0].pName = "main";
-	vertexStages[0].pNext = nullptr;
-	vertexStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertexStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-
-	VkShaderModule fragmentShaderModule;
-	Utils::loadShader("Engine/src/shaders/spirv/rect.frag.spirv", mDevice, &fragmentShaderModule);
-	vertexStages[1].flags = 0;
-	vertexStages[1].module = fragmentShaderModule;
-	vertexStages[1].pName = "main";
-	vertexStages[1].pNext = nullptr;
-	vertexStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	vertexStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-
-	VkPushConstantRange pcRange{};
-	pcRange.offset = 0;
-	pcRange.size = sizeof(ModelStruct);
-	pcRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	VkPipelineLayoutCreateInfo layoutInfo{};
-	layoutInfo.flags = 0;
-	layoutInfo.pNext = nullptr;
-	layoutInfo.pPushConstantRanges = &pcRange;
-	layoutInfo.pushConstantRangeCount = 1;
-	layoutInfo.pSetLayouts = nullptr;
-	layoutInfo.setLayoutCount = 0;
-	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	vkCreatePipelineLayout(mDevice, &layoutInfo, nullptr, &mGraphicPipelineLayout);
-
-	VkPipelineColorBlendAttachmentState blendAttachmentState{};
-	blendAttachmentState.blendEnable = VK_FALSE;
-	blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	VkPipelineColorBlendStateCreateInfo blend{};
-	blend.attachmentCount = 1;
-	blend.flags = 0;
-	blend.pAttachments = &blendAttachmentState;
-	blend.logicOpEnable = VK_FALSE;
-	blend.pNext = nullptr;
-	blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-
-	VkPipelineDepthStencilStateCreateInfo depthStencilState{};
-	depthStencilState.depthTestEnable = true;
-	depthStencilState.depthWriteEnable = true;
-	depthStencilState.depthCompareOp  = VK_COMPARE_OP_LESS_OR_EQUAL;
-	depthStencilState.maxDepthBounds = 1.0f;
-	depthStencilState.minDepthBounds = 0.0f;
-	depthStencilState.stencilTestEnable = VK_FALSE;
-	depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-
-	VkPipelineDynamicStateCreateInfo dynamicState{};
-	VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-	dynamicState.dynamicStateCount = 2;
-	dynamicState.flags = 0;
-	dynamicState.pDynamicStates = dynamicStates;
-	dynamicState.pNext = nullptr;
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-
-	VkPipelineInputAssemblyStateCreateInfo assembly{};
-	assembly.flags = 0;
-	assembly.pNext = nullptr;
-	assembly.primitiveRestartEnable = VK_FALSE;
-	assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-	VkPipelineMultisampleStateCreateInfo msInfo{};
-	msInfo.alphaToCoverageEnable = VK_FALSE;
-	msInfo.alphaToOneEnable = VK_FALSE;
-	msInfo.flags = 0;
-	msInfo.pNext = nullptr;
-	msInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	msInfo.sampleShadingEnable = VK_FALSE;
-	msInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-
-	VkPipelineRasterizationStateCreateInfo rasterInfo{};
-	rasterInfo.cullMode  = VK_CULL_MODE_NONE;
-	rasterInfo.depthBiasEnable = VK_FALSE;
-	rasterInfo.depthClampEnable = VK_FALSE;
-	rasterInfo.flags = 0;
-	rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterInfo.lineWidth = 1.0f;
-	rasterInfo.pNext = nullptr;
-	rasterInfo.polygonMode = VK_POLYGON_MODE_LINE;;
-	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
-	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-
-	VkPipelineViewportStateCreateInfo viewPortInfo{};
-	viewPortInfo.flags = 0;
-	viewPortInfo.pNext = nullptr;
-	viewPortInfo.pScissors = nullptr;
-	viewPortInfo.pViewports = nullptr;
-	viewPortInfo.scissorCount = 1;
-	viewPortInfo.viewportCount = 1;
-	viewPortInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-
-	VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	VkPipelineRenderingCreateInfo renderingInfo{};
-	renderingInfo.colorAttachmentCount = 1;
-	renderingInfo.pNext = nullptr;
-	renderingInfo.pColorAttachmentFormats = &mDrawColorImage.format;
-	renderingInfo.depthAttachmentFormat = mDrawDepthImage.format;
-	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-	renderingInfo.viewMask = 0;
-
-	VkPipelineVertexInputStateCreateInfo inputInfo{};
-	inputInfo.flags = 0;
-	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.flags = 0;
-	pipelineInfo.layout = mGraphicPipelineLayout;
-	pipelineInfo.pColorBlendState = &blend;
-	pipelineInfo.pDepthStencilState = &depthStencilState;
-	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.pInputAssemblyState = &assembly;
-	pipelineInfo.pMultisampleState = &msInfo;
-	pipelineInfo.pNext = &renderingInfo;
-	pipelineInfo.pRasterizationState = &rasterInfo;
-	pipelineInfo.pStages = vertexStages;
-	pipelineInfo.pTessellationState = nullptr;
-	pipelineInfo.pVertexInputState = &inputInfo;
-	pipelineInfo.pViewportState = &viewPortInfo;
-	pipelineInfo.renderPass = nullptr;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	vkCreateGraphicsPipelines(mDevice, nullptr, 1, &pipelineInfo, nullptr, &mGraphicPipeline);
-
-	vkDestroyShaderModule(mDevice, vertexShaderModule, nullptr);
-	vkDestroyShaderModule(mDevice, fragmentShaderModule, nullptr);
-	mMainDeletionQueue.push_back([=]() {
-		vkDestroyPipelineLayout(mDevice, mGraphicPipelineLayout, nullptr);
-		vkDestroyPipeline(mDevice, mGraphicPipeline, nullptr);
-		});
+	//plain state for the same shaders, drawn with while the real pipeline compiles
+	GraphicsPipelineBuilder fallbackBuilder;
+	fallbackBuilder.setShaders("rect.vert", "rect.frag")
+		.addColorFormat(mDrawColorImage.format)
+		.setDepthFormat(mDrawDepthFormat)
+		.setLayout(mBindlessHeap.pipelineLayout());
+	PipelineHandle fallback = mPipelines.request(fallbackBuilder, "rect fallback");
+	if (mMeshShaders)
+	{
+		//a vertex pipeline can't stand in for mesh tasks draws, so it is part of the startup batch
+		GraphicsPipelineBuilder meshletBuilder;
+		meshletBuilder.setMeshShaders("meshlet.task", "meshlet.mesh", "rect.frag")
+			.setPolygonMode(mConfig.wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL)
+			.enableDepthTest(true, VK_COMPARE_OP_LESS_OR_EQUAL)
+			.addColorFormat(mDrawColorImage.format)
+			.setDepthFormat(mDrawDepthFormat)
+			.setLayout(mBindlessHeap.pipelineLayout());
+		mMeshletPipeline = mPipelines.request(meshletBuilder, "meshlet");
+	}
+	//everything requested so far is needed from the first frame, compile it together on the workers
+	mPipelines.compilePending();
+
+	//requested after the batch, compiles in the background once a draw first needs it
+	GraphicsPipelineBuilder builder;
+	builder.setShaders("rect.vert", "rect.frag")
+		.setPolygonMode(mConfig.wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL)
+		.enableDepthTest(true, VK_COMPARE_OP_LESS_OR_EQUAL)
+		.addColorFormat(mDrawColorImage.format)
+		.setDepthFormat(mDrawDepthFormat)
+		.setLayout(mBindlessHeap.pipelineLayout());
+	mGeometryPipeline = mPipelines.request(builder, "rect", fallback);
 }
 
 FrameData& KEngine::currentFrame()
 {
-	return mFrameData[(mFrameCounter + 1) % FRAME_OVERLAP];
+	return mFrameData[currentFrameIndex()];
+}
+
+uint KEngine::currentFrameIndex() const
+{
+	return mFrameCounter % mFramesInFlight;
+}
+
+void KEngine::waitForFrame(FrameData& frame)
+{
+	KS_PROFILE_FUNCTION();
+	//only block when the gpu is genuinely mFramesInFlight frames behind
+	uint64_t completedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mFrameTimeline, &completedValue));
+	if (completedValue < frame.timelineValue)
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.pNext = nullptr;
+		waitInfo.flags = 0;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &mFrameTimeline;
+		waitInfo.pValues = &frame.timelineValue;
+		VK_CHECK(vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX));
+	}
+	resolveReadbacks(frame);
+	frame.deletionQueue.flush();
+}
+
+uint64_t KEngine::submitAsyncCompute(VkCommandBuffer cmd)
+{
+	//earlier graphics work may still read what the compute passes overwrite, but only the submission that
+	//last used those resources matters, and only the stages the passes run at have to wait for it
+	uint64_t dependencyValue = mRenderGraph.asyncDependencyValue();
+	VkSemaphoreSubmitInfo waitInfo = VkInitializer::createSemaphoreSubmitInfo(mFrameTimeline, mRenderGraph.asyncStages(), dependencyValue);
+	VkSemaphoreSubmitInfo signalInfo = VkInitializer::createSemaphoreSubmitInfo(mComputeTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ++mComputeTimelineValue);
+	VkCommandBufferSubmitInfo commandBufferInfo = VkInitializer::createCommandBufferSubmitInfo(cmd);
+	VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, &signalInfo, 1, &waitInfo, dependencyValue > 0 ? 1 : 0);
+	VK_CHECK(vkQueueSubmit2(mComputeQueue, 1, &submitInfo, nullptr));
+	return mComputeTimelineValue;
 }
 
-void KEngine::drawBackground()
+void KEngine::waitForAllFrames()
 {
-	vkCmdBindPipeline(currentFrame().commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputePipeline);
-	vkCmdBindDescriptorSets(currentFrame().commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputePipelineLayout, 0, 1, &mComputeDescriptorSet, 0, nullptr);
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		waitForFrame(mFrameData[i]);
+	}
+}
+
+void KEngine::setFramesInFlight(uint count)
+{
+	count = std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT);
+	if (count == mFramesInFlight)
+	{
+		return;
+	}
+	//frame slots are remapped by the new count, drain them first
+	if (mInitialized)
+	{
+		waitForAllFrames();
+	}
+	mFramesInFlight = count;
+	mConfig.framesInFlight = count;
+	KS_CORE_INFO("Frames in flight: {}", mFramesInFlight);
+}
+
+void KEngine::drawBackground(VkCommandBuffer cmd)
+{
+	KS_PROFILE_FUNCTION();
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines.get(mBackgroundPipeline));
 	BackGroundPushConstants pushConstants;
 	pushConstants.topColor = { 1.0, 1.0, 1.0, 1.0 };
 	pushConstants.bottomColor = { 1.0, 1.0, 0.0, 1.0 };
+	pushConstants.drawExtent = glm::ivec2(mDrawExtent.width, mDrawExtent.height);
+	pushConstants.drawImage = mDrawColorHandle;
 	VkPushConstantsInfo pcInfo{};
-	pcInfo.layout = mComputePipelineLayout;
+	pcInfo.layout = mBindlessHeap.pipelineLayout();
 	pcInfo.offset = 0;
 	pcInfo.pNext = nullptr;
 	pcInfo.pValues = &pushConstants;
 	pcInfo.size = sizeof(BackGroundPushConstants);
-	pcInfo.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pcInfo.stageFlags = VK_SHADER_STAGE_ALL;
 	pcInfo.sType = VK_STRUCTURE_TYPE_PUSH_CONSTANTS_INFO;
-	vkCmdPushConstants(currentFrame().commandBuffer, mComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BackGroundPushConstants), &pushConstants);
-	vkCmdDispatch(currentFrame().commandBuffer, (uint32_t)std::ceil(mDrawColorImage.extent.width / 16.f), (uint32_t)std::ceil(mDrawColorImage.extent.height / 16.f), 1);
+	vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(BackGroundPushConstants), &pushConstants);
+	VkExtent3D groups = mPipelines.groupCount(mBackgroundPipeline, VkExtent3D{ mDrawExtent.width, mDrawExtent.height, 1 });
+	vkCmdDispatch(cmd, groups.width, groups.height, groups.depth);
+}
+
+glm::mat4 KEngine::viewMatrix() const
+{
+	return glm::translate(glm::mat4(1.0), glm::vec3{ 0, 0, -3 });
+}
+
+glm::mat4 KEngine::viewProjection() const
+{
+	glm::mat4 projection = glm::perspective(glm::radians(70.f), (float)mDrawExtent.width / (float)mDrawExtent.height, 0.01f, 1000.0f);
+	return projection * viewMatrix();
+}
+
+void KEngine::generateDrawCommands(VkCommandBuffer cmd, CullPhase phase)
+{
+	KS_PROFILE_FUNCTION();
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines.get(mDrawCommandPipeline));
+	DrawCommandPushConstants pushConstants;
+	pushConstants.viewProj = viewProjection();
+	pushConstants.objectAddress = mScene.objectAddress();
+	pushConstants.commandAddress = mScene.commandAddress();
+	pushConstants.countAddress = mScene.countAddress();
+	pushConstants.visibilityAddress = mScene.visibilityAddress();
+	pushConstants.selectionAddress = mScene.selectionAddress();
+	pushConstants.objectCount = mScene.objectCount();
+	pushConstants.phase = phase;
+	pushConstants.depthPyramid = mDepthPyramid.sampledHandle();
+	pushConstants.depthSampler = mDepthPyramid.samplerHandle();
+	pushConstants.selectMeshlets = mConfig.meshletCulling ? 1 : 0;
+	pushConstants.index16ObjectCount = mScene.index16ObjectCount();
+	vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(DrawCommandPushConstants), &pushConstants);
+	VkExtent3D groups = mPipelines.groupCount(mDrawCommandPipeline, VkExtent3D{ mScene.objectCount(), 1, 1 });
+	vkCmdDispatch(cmd, groups.width, groups.height, groups.depth);
+}
+
+void KEngine::updateCullView(VkCommandBuffer cmd)
+{
+	CullView view;
+	view.viewProj = viewProjection();
+	view.cameraPosition = glm::inverse(viewMatrix())[3];
+	view.viewportSize = glm::vec2(mDrawExtent.width, mDrawExtent.height);
+	view.padding = glm::vec2(0.0f);
+	vkCmdUpdateBuffer(cmd, mScene.viewBuffer(), 0, sizeof(CullView), &view);
+}
+
+void KEngine::cullMeshlets(VkCommandBuffer cmd)
+{
+	KS_PROFILE_FUNCTION();
+	if (mScene.meshletCount() == 0)
+	{
+		return;
+	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines.get(mMeshletCullPipeline));
+	MeshletCullPushConstants pushConstants;
+	pushConstants.viewAddress = mScene.viewAddress();
+	pushConstants.objectAddress = mScene.objectAddress();
+	pushConstants.meshletAddress = mScene.meshletAddress();
+	pushConstants.indexAddress = mGeometryBuffer.indexAddress();
+	pushConstants.vertexAddress = mGeometryBuffer.vertexAddress();
+	pushConstants.selectionAddress = mScene.selectionAddress();
+	pushConstants.meshletIndexAddress = mScene.meshletIndexAddress();
+	pushConstants.commandAddress = mScene.commandAddress() + mScene.meshletCommandOffset();
+	pushConstants.countAddress = mScene.countAddress() + DRAW_COUNT_MESHLET16 * sizeof(uint32_t);
+	pushConstants.meshletCount = mScene.meshletCount();
+	pushConstants.index16MeshletCount = mScene.index16MeshletCount();
+	pushConstants.faceCulling = mConfig.wireframe ? 0 : 1;
+	vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(MeshletCullPushConstants), &pushConstants);
+	//a workgroup per meshlet, rows as wide as the device allows
+	uint32_t width = std::min(mScene.meshletCount(), mMeshletDispatchWidth);
+	vkCmdDispatch(cmd, width, (mScene.meshletCount() + width - 1) / width, 1);
 }
 
-void KEngine::drawGeometry()
+void KEngine::buildDepthPyramid(VkCommandBuffer cmd, VkImageView depthView)
 {
-	vkCmdBindPipeline(currentFrame().commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicPipeline);
+	KS_PROFILE_FUNCTION();
+	//each frame slot samples through its own handle, frames still in flight keep reading the view they were recorded with
+	FrameData& frame = currentFrame();
+	if (frame.depthHandle == INVALID_BINDLESS_HANDLE)
+	{
+		frame.depthHandle = mBindlessHeap.registerSampledImage(depthView);
+	}
+	else if (frame.depthView != depthView)
+	{
+		mBindlessHeap.updateSampledImage(frame.depthHandle, depthView);
+	}
+	frame.depthView = depthView;
+	//depth is allocated for the largest window, level 0 only reads the drawn region
+	glm::vec2 depthScale{ static_cast<float>(mDrawExtent.width) / mDrawColorImage.extent.width, static_cast<float>(mDrawExtent.height) / mDrawColorImage.extent.height };
+	mDepthPyramid.build(cmd, mPipelines, mDepthReducePipeline, mBindlessHeap.pipelineLayout(), frame.depthHandle, depthScale);
+}
+
+void KEngine::drawGeometry(VkCommandBuffer cmd, VkImageView depthView, VkAttachmentLoadOp depthLoadOp)
+{
+	KS_PROFILE_FUNCTION();
+	bool meshTasks = drawMeshTasks() && mScene.objectCount() > 0;
+	VkPipeline pipeline = mPipelines.acquire(meshTasks ? mMeshletPipeline : mGeometryPipeline);
+	if (!pipeline)
+	{
+		//neither the pipeline nor its fallback is compiled yet, skip the pass this frame
+		return;
+	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 	VkViewport viewport{};
 	viewport.x = 0;
 	viewport.y = 0;
-	viewport.width = mDrawColorImage.extent.width;
-	viewport.height = mDrawColorImage.extent.height;
-	vkCmdSetViewport(currentFrame().commandBuffer, 0, 1, &viewport);
+	viewport.width = mDrawExtent.width;
+	viewport.height = mDrawExtent.height;
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
 	VkRect2D scissor{};	
 	scissor.offset = { 0, 0 };
-	scissor.extent = { mDrawColorImage.extent.width, mDrawColorImage.extent.height };
-	vkCmdSetScissor(currentFrame().commandBuffer, 0, 1, &scissor);
+	scissor.extent = mDrawExtent;
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
 	VkRenderingAttachmentInfo colorAttachmentInfo{};
 	colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	colorAttachmentInfo.imageView = mDrawColorImage.imageView;
@@ -597,8 +1248,8 @@ void KEngine::drawGeometry()
 	VkRenderingAttachmentInfo depthAttachmentInfo{};
 	depthAttachmentInfo.clearValue.depthStencil.depth = 1.0f;
 	depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-	depthAttachmentInfo.imageView = mDrawDepthImage.imageView;
-	depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachmentInfo.imageView = depthView;
+	depthAttachmentInfo.loadOp = depthLoadOp;
 	depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	depthAttachmentInfo.pNext = nullptr;
@@ -612,125 +1263,222 @@ void KEngine::drawGeometry()
 	renderingInfo.pNext = nullptr;
 	renderingInfo.pStencilAttachment = nullptr;
 	renderingInfo.renderArea.offset = { 0, 0 };
-	renderingInfo.renderArea.extent = { mDrawColorImage.extent.width, mDrawColorImage.extent.height };
+	renderingInfo.renderArea.extent = mDrawExtent;
 	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
 	renderingInfo.viewMask = 0;
-	vkCmdBeginRendering(currentFrame().commandBuffer, &renderingInfo);
-
-
-	glm::mat4 view = glm::translate(glm::mat4(1.0), glm::vec3{ 0, 0, -3 });
-	glm::mat4 projection = glm::perspective(glm::radians(70.f), (float)mSwapChainExtent.width / (float)mSwapChainExtent.height, 0.01f, 1000.0f);
-	glm::mat4 viewProj = projection * view;
-	projection[1][1] *= -1;
-
-	//for (auto& mesh : mMeshes)
-	//{
-	//	vkCmdBindIndexBuffer(currentFrame().commandBuffer, mesh->meshBuffer.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-	//	ModelStruct modelInfo;
-	//	modelInfo.modelMatrix = viewProj;
-	//	modelInfo.vertexAddress = mesh->meshBuffer.vertexAddress;
-	//	vkCmdPushConstants(currentFrame().commandBuffer, mGraphicPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelStruct), &modelInfo);
-	//	//VkCommandBuffer                             commandBuffer,
-	//	//uint32_t                                    indexCount,
-	//	//uint32_t                                    instanceCount,
-	//	//uint32_t                                    firstIndex,
-	//	//int32_t                                     vertexOffset,
-	//	//uint32_t                                    firstInstance
-	//	for (auto& surface : mesh->surfaces)
-	//	{
-	//		vkCmdDrawIndexed(currentFrame().commandBuffer, surface.indexCount, 1, surface.startIndex, 0, 0);
-	//	}
-	//}
-	ModelStruct modelInfo;
-	modelInfo.modelMatrix = viewProj;
-	modelInfo.vertexAddress = mMeshes[2]->meshBuffer.vertexAddress;
-	
-	vkCmdPushConstants(currentFrame().commandBuffer, mGraphicPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ModelStruct), &modelInfo);
-	vkCmdBindIndexBuffer(currentFrame().commandBuffer, mMeshes[2]->meshBuffer.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-	
-	vkCmdDrawIndexed(currentFrame().commandBuffer, mMeshes[2]->surfaces[0].indexCount, 1, mMeshes[2]->surfaces[0].startIndex, 0, 0);
-	vkCmdEndRendering(currentFrame().commandBuffer);
-}
+	vkCmdBeginRendering(cmd, &renderingInfo);
 
-void KEngine::immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
-{
-	vkResetFences(mDevice, 1, &mImmediateSubmitFence);
-	vkResetCommandBuffer(mImmediateSubmitCmd, 0);
-	VkCommandBufferBeginInfo beginInfo = VkInitializer::createCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	VK_CHECK(vkBeginCommandBuffer(mImmediateSubmitCmd, &beginInfo));
-	function(mImmediateSubmitCmd);
-	VK_CHECK(vkEndCommandBuffer(mImmediateSubmitCmd));
-	VkCommandBufferSubmitInfo commandBufferInfo = VkInitializer::createCommandBufferSubmitInfo(mImmediateSubmitCmd);
-	VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, nullptr, nullptr);
-	VK_CHECK(vkQueueSubmit2(mQueue, 1, &submitInfo, mImmediateSubmitFence));
-	vkWaitForFences(mDevice, 1, &mImmediateSubmitFence, true, UINT64_MAX);
+
+	glm::mat4 viewProj = viewProjection();
+	DrawPushConstants drawInfo;
+	drawInfo.viewProj = viewProj;
+	drawInfo.vertexAddress = mGeometryBuffer.vertexAddress();
+	drawInfo.objectAddress = mScene.objectAddress();
+
+	if (meshTasks)
+	{
+		MeshletDrawPushConstants meshletInfo;
+		meshletInfo.viewAddress = mScene.viewAddress();
+		meshletInfo.objectAddress = mScene.objectAddress();
+		meshletInfo.meshletAddress = mScene.meshletAddress();
+		meshletInfo.indexAddress = mGeometryBuffer.indexAddress();
+		meshletInfo.vertexAddress = mGeometryBuffer.vertexAddress();
+		meshletInfo.selectionAddress = mScene.selectionAddress();
+		meshletInfo.meshletCount = mScene.meshletCount();
+		meshletInfo.faceCulling = mConfig.wireframe ? 0 : 1;
+		vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(MeshletDrawPushConstants), &meshletInfo);
+		//the task shader culls MESHLET_TASK_GROUP_SIZE meshlets per group and launches a mesh group per survivor
+		uint32_t taskGroups = (mScene.meshletCount() + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE;
+		if (taskGroups > 0)
+		{
+			mCmdDrawMeshTasks(cmd, taskGroups, 1, 1);
+		}
+	}
+	else if (mConfig.meshletCulling && mScene.meshletCount() > 0)
+	{
+		vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(DrawPushConstants), &drawInfo);
+		//one command per surviving meshlet, the compacted indices keep their mesh's index type
+		uint32_t index16Meshlets = mScene.index16MeshletCount();
+		uint32_t index32Meshlets = mScene.meshletCount() - index16Meshlets;
+		if (index16Meshlets > 0)
+		{
+			vkCmdBindIndexBuffer(cmd, mScene.meshletIndexBuffer(), 0, VK_INDEX_TYPE_UINT16);
+			vkCmdDrawIndexedIndirectCount(cmd, mScene.commandBuffer(), mScene.meshletCommandOffset(), mScene.countBuffer(), DRAW_COUNT_MESHLET16 * sizeof(uint32_t),
+				index16Meshlets, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		if (index32Meshlets > 0)
+		{
+			vkCmdBindIndexBuffer(cmd, mScene.meshletIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexedIndirectCount(cmd, mScene.commandBuffer(), mScene.meshletCommandOffset() + index16Meshlets * sizeof(VkDrawIndexedIndirectCommand),
+				mScene.countBuffer(), DRAW_COUNT_MESHLET32 * sizeof(uint32_t), index32Meshlets, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+	//whole objects: all of them without meshlet culling, otherwise the ones whose meshlets did not fit the scene
+	uint32_t wholeObjects = mConfig.meshletCulling ? mScene.unmeshedObjectCount() : mScene.objectCount();
+	VkPipeline wholePipeline = meshTasks && wholeObjects > 0 ? mPipelines.acquire(mGeometryPipeline) : pipeline;
+	if (wholeObjects > 0 && wholePipeline)
+	{
+		if (wholePipeline != pipeline)
+		{
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, wholePipeline);
+		}
+		vkCmdPushConstants(cmd, mBindlessHeap.pipelineLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(DrawPushConstants), &drawInfo);
+		//every mesh lives in the geometry buffer, one call per index type whatever the object count.
+		//16 bit objects come first, their commands and count sit before the 32 bit ones
+		uint32_t index16Objects = mScene.index16ObjectCount();
+		uint32_t index32Objects = mScene.objectCount() - index16Objects;
+		if (index16Objects > 0)
+		{
+			vkCmdBindIndexBuffer(cmd, mGeometryBuffer.indexBuffer(), 0, VK_INDEX_TYPE_UINT16);
+			vkCmdDrawIndexedIndirectCount(cmd, mScene.commandBuffer(), 0, mScene.countBuffer(), DRAW_COUNT_INDEX16 * sizeof(uint32_t),
+				index16Objects, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		if (index32Objects > 0)
+		{
+			vkCmdBindIndexBuffer(cmd, mGeometryBuffer.indexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexedIndirectCount(cmd, mScene.commandBuffer(), index16Objects * sizeof(VkDrawIndexedIndirectCommand),
+				mScene.countBuffer(), DRAW_COUNT_INDEX32 * sizeof(uint32_t), index32Objects, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+	vkCmdEndRendering(cmd);
 }
 
-MeshBuffer KEngine::loadMeshBuffer(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+MeshBuffer KEngine::loadMeshBuffer(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& meshletData)
 {
+	KS_PROFILE_FUNCTION();
 	MeshBuffer newBuffer;
-	size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
-	size_t indexBufferSize = indices.size() * sizeof(uint32_t);
-
-	newBuffer.vertexBuffer = VkInitializer::createBuffer(mMemAllocator, vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-	VkBufferDeviceAddressInfo addressInfo{};
-	addressInfo.buffer = newBuffer.vertexBuffer.buffer;
-	addressInfo.pNext = nullptr;
-	addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-	newBuffer.vertexAddress = vkGetBufferDeviceAddress(mDevice, &addressInfo);
-	newBuffer.indexBuffer = VkInitializer::createBuffer(mMemAllocator, indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-	
-	AllocatedBuffer stagingBuffer = VkInitializer::createBuffer(mMemAllocator, vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-	void* mappedData = stagingBuffer.allocationInfo.pMappedData;
-	memcpy(mappedData, vertices.data(), vertexBufferSize);
-	memcpy((static_cast<char*>(mappedData) + vertexBufferSize), indices.data(), indexBufferSize);
-	immediateSubmit([&](VkCommandBuffer cmd)
-	{
-		VkBufferCopy2 copyRegion{};	
-		copyRegion.dstOffset = 0;
-		copyRegion.pNext = nullptr;
-		copyRegion.size = vertexBufferSize;
-		copyRegion.srcOffset = 0;
-		copyRegion.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
-		VkCopyBufferInfo2 copyInfo{};
-		copyInfo.dstBuffer = newBuffer.vertexBuffer.buffer;
-		copyInfo.pNext = nullptr;
-		copyInfo.pRegions = &copyRegion;
-		copyInfo.regionCount = 1;
-		copyInfo.srcBuffer = stagingBuffer.buffer;
-		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-		vkCmdCopyBuffer2(cmd, &copyInfo);
-
-		VkBufferCopy2 copyIndexRegion{};
-		copyIndexRegion.dstOffset = 0;
-		copyIndexRegion.pNext = nullptr;
-		copyIndexRegion.size = indexBufferSize;
-		copyIndexRegion.srcOffset = vertexBufferSize;
-		copyIndexRegion.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
-		VkCopyBufferInfo2 copyIndexInfo{};
-		copyIndexInfo.dstBuffer = newBuffer.indexBuffer.buffer;
-		copyIndexInfo.pNext = nullptr;
-		copyIndexInfo.pRegions = &copyIndexRegion;
-		copyIndexInfo.regionCount = 1;
-		copyIndexInfo.srcBuffer = stagingBuffer.buffer;
-		copyIndexInfo.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-		vkCmdCopyBuffer2(cmd, &copyIndexInfo);
-	});
-	vmaDestroyBuffer(mMemAllocator, stagingBuffer.buffer, stagingBuffer.allocation);
+	newBuffer.vertexAddress = mGeometryBuffer.vertexAddress();
+	//indices are relative to the mesh, 16 bits address up to 65536 vertices. packed two per word
+	bool index16 = vertices.size() <= static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1;
+	uint32_t indexWords = static_cast<uint32_t>(index16 ? (indices.size() + 1) / 2 : indices.size());
+	if (!mGeometryBuffer.allocate(static_cast<uint32_t>(vertices.size()), indexWords + static_cast<uint32_t>(meshletData.size()), newBuffer.geometry))
+	{
+		//left empty, draws of an empty range are skipped
+		return newBuffer;
+	}
+	newBuffer.geometry.indexType = index16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	newBuffer.meshletDataOffset = indexWords;
+	std::vector<uint16_t> narrowIndices;
+	if (index16)
+	{
+		//an odd count leaves the last half word zero
+		narrowIndices.assign(static_cast<size_t>(indexWords) * 2, 0);
+		std::copy(indices.begin(), indices.end(), narrowIndices.begin());
+	}
+	newBuffer.quantization = VertexPacking::computeQuantization(vertices);
+	std::vector<PackedVertex> packedVertices;
+	VertexPacking::packVertices(vertices, newBuffer.quantization, packedVertices);
+	size_t vertexBufferSize = packedVertices.size() * sizeof(PackedVertex);
+	size_t indexBufferSize = static_cast<size_t>(indexWords) * sizeof(uint32_t);
+	const void* indexData = index16 ? static_cast<const void*>(narrowIndices.data()) : static_cast<const void*>(indices.data());
+
+	//the vertex copy never goes out in a later batch than the index copies, the last ticket covers all of them
+	mUploadManager.uploadBuffer(mGeometryBuffer.vertexBuffer(), mGeometryBuffer.vertexByteOffset(newBuffer.geometry), packedVertices.data(), vertexBufferSize);
+	newBuffer.uploadTicket = mUploadManager.uploadBuffer(mGeometryBuffer.indexBuffer(), mGeometryBuffer.indexByteOffset(newBuffer.geometry), indexData, indexBufferSize);
+	if (!meshletData.empty())
+	{
+		VkDeviceSize meshletByteOffset = mGeometryBuffer.indexByteOffset(newBuffer.geometry) + indexBufferSize;
+		newBuffer.uploadTicket = mUploadManager.uploadBuffer(mGeometryBuffer.indexBuffer(), meshletByteOffset, meshletData.data(), meshletData.size() * sizeof(uint32_t));
+	}
 	return newBuffer;
 }
 
-void KEngine::initDefaultData()
+void KEngine::freeMeshBuffer(MeshBuffer& meshBuffer)
 {
-	mMeshes = LoadGltfMeshAsserts(this, "asset/models/basicmesh.glb");
+	//frames submitted so far may still draw it, the range is reused once they are done
+	mGeometryFrees.push_back(PendingGeometryFree{ mFrameTimelineValue, meshBuffer.geometry });
+	meshBuffer.geometry = GeometryRange{};
+}
 
-	mMainDeletionQueue.push_back([&]() {
-		for (auto& mesh : mMeshes)
+void KEngine::updateGeometryBuffer(VkCommandBuffer cmd)
+{
+	uint64_t completedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mFrameTimeline, &completedValue));
+	auto iter = std::remove_if(mGeometryFrees.begin(), mGeometryFrees.end(), [&](PendingGeometryFree& pending) {
+		if (pending.frameTimelineValue > completedValue)
 		{
-			vmaDestroyBuffer(mMemAllocator, mesh->meshBuffer.indexBuffer.buffer, mesh->meshBuffer.indexBuffer.allocation);
-			vmaDestroyBuffer(mMemAllocator, mesh->meshBuffer.vertexBuffer.buffer, mesh->meshBuffer.vertexBuffer.allocation);
+			return false;
 		}
+		mGeometryBuffer.free(pending.range);
+		return true;
 	});
+	mGeometryFrees.erase(iter, mGeometryFrees.end());
+
+	//copies into the old buffers would be lost, only compact when no upload or free is pending
+	if (mGeometryBuffer.fragmentation() < GEOMETRY_DEFRAGMENT_THRESHOLD || !mUploadManager.idle() || !mGeometryFrees.empty())
+	{
+		return;
+	}
+	KS_PROFILE_FUNCTION();
+	std::vector<GeometryRange*> liveRanges;
+	liveRanges.reserve(mMeshes.size());
+	for (auto& mesh : mMeshes)
+	{
+		liveRanges.push_back(&mesh->meshBuffer.geometry);
+	}
+	if (!mGeometryBuffer.defragment(cmd, liveRanges, currentFrame().deletionQueue))
+	{
+		return;
+	}
+	for (auto& mesh : mMeshes)
+	{
+		mesh->meshBuffer.vertexAddress = mGeometryBuffer.vertexAddress();
+	}
+	//this frame already draws from the moved ranges, the objects pointing at them have to be live too.
+	//compaction is rare enough to wait for the small upload
+	buildScene();
+	mUploadManager.wait(mUploadManager.flush());
+	mFrameUploadValue = mUploadManager.completedValue();
+}
+
+void KEngine::initDefaultData()
+{
+	KS_PROFILE_FUNCTION();
+	mMeshes = LoadGltfMeshAsserts(this, "asset/models/basicmesh.glb", mConfig.optimizeMeshes);
+	buildScene();
+}
+
+void KEngine::requestReadback(ReadbackCallback&& callback)
+{
+	mReadbackRequests.push_back(std::move(callback));
+}
+
+void KEngine::recordReadbacks(VkCommandBuffer cmd)
+{
+	//the render graph puts the draw color image in TRANSFER_SRC_OPTIMAL before this pass
+	for (auto& callback : mReadbackRequests)
+	{
+		PendingReadback readback;
+		readback.extent = VkExtent3D{ mDrawExtent.width, mDrawExtent.height, 1 };
+		readback.format = mDrawColorImage.format;
+		readback.frameNumber = mFrameCounter;
+		readback.callback = std::move(callback);
+		size_t size = static_cast<size_t>(readback.extent.width) * readback.extent.height * vkutil::formatTexelSize(readback.format);
+		readback.buffer = VkInitializer::createBuffer(mMemAllocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+		vkutil::copyImageToBuffer(cmd, mDrawColorImage.image, readback.buffer.buffer, readback.extent);
+		currentFrame().readbacks.push_back(std::move(readback));
+	}
+	mReadbackRequests.clear();
+}
+
+void KEngine::resolveReadbacks(FrameData& frame)
+{
+	//only called once the frame's fence has been waited on, the copies are finished
+	for (auto& readback : frame.readbacks)
+	{
+		vmaInvalidateAllocation(mMemAllocator, readback.buffer.allocation, 0, VK_WHOLE_SIZE);
+		ReadbackImage image;
+		image.frameNumber = readback.frameNumber;
+		image.extent = readback.extent;
+		image.format = readback.format;
+		const uint8_t* mapped = static_cast<const uint8_t*>(readback.buffer.allocationInfo.pMappedData);
+		size_t size = static_cast<size_t>(image.extent.width) * image.extent.height * vkutil::formatTexelSize(image.format);
+		image.pixels.assign(mapped, mapped + size);
+		readback.callback(image);
+		vmaDestroyBuffer(mMemAllocator, readback.buffer.buffer, readback.buffer.allocation);
+	}
+	frame.readbacks.clear();
 }
 
 void KEngine::initWindow()
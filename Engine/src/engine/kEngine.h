@@ -3,20 +3,116 @@
 #include <vk_mem_alloc.h>
 #include <memory>
 #include <vector>
+#include <string>
 #include "typedef.h"
 #include "type.h"
 #include "gltfLoader.h"
 #include "descriptor/descriptorAllocator.h"
+#include "descriptor/bindlessHeap.h"
+#include "pipeline/computeTuning.h"
+#include "pipeline/pipelineCache.h"
+#include "pipeline/pipelineManager.h"
+#include "shader/shaderArchive.h"
+#include "shader/shaderModuleCache.h"
+#include "shader/shaderWatcher.h"
+#include "profiler/gpuProfiler.h"
+#include "renderGraph/renderGraph.h"
+#include "upload/uploadManager.h"
+#include "geometry/geometryBuffer.h"
+#include "scene/gpuScene.h"
+#include "culling/depthPyramid.h"
 
-constexpr static int FRAME_OVERLAP = 2;
+constexpr static uint MAX_FRAMES_IN_FLIGHT = 4;
+//share of free geometry space outside the largest free range that triggers a compaction
+constexpr static float GEOMETRY_DEFRAGMENT_THRESHOLD = 0.5f;
+
+struct EngineConfig
+{
+	uint width			{ 1280  };
+	uint height			{ 720   };
+	//render without SDL window and swapchain, only into the draw images
+	bool headless		{ false };
+	uint headlessFrames	{ 1		};
+	//1 ~ MAX_FRAMES_IN_FLIGHT, more frames trade latency for throughput
+	uint framesInFlight	{ 2		};
+	//chrome trace json of the gpu pass timings written on cleanUp, empty to disable
+	std::string gpuTracePath;
+	//chrome trace json of the cpu profile zones written on cleanUp, empty to disable
+	std::string cpuTracePath;
+	//persistently mapped staging ring used by all uploads
+	uint stagingSizeMB	{ 32	};
+	//capacity of the shared geometry buffer in vertices and indices
+	uint geometryVertexCapacity{ 1u << 21 };
+	uint geometryIndexCapacity { 1u << 23 };
+	//objects the gpu driven geometry pass can draw
+	uint maxDrawObjects { 1u << 16 };
+	//two phase hierarchical z culling of the draw objects, frustum culling only when off
+	bool occlusionCulling{ true };
+	//draw the objects as meshlets culled by their bounding sphere and normal cone
+	bool meshletCulling { true };
+	uint maxDrawMeshlets{ 1u << 15 };
+	//reorder loaded triangles for the post transform cache and overdraw, vertices for fetch locality
+	bool optimizeMeshes { true };
+	//task and mesh shaders when the device has VK_EXT_mesh_shader, otherwise a compute pass culls the
+	//triangles and the meshlets are drawn from the compacted indices
+	bool meshShaders	{ true	};
+	//submit async render graph passes to a dedicated compute family when the device has one
+	bool asyncCompute	{ true	};
+	//pipeline cache file reused across runs, empty to compile from scratch every launch
+	std::string pipelineCachePath{ "pipeline.cache" };
+	//packed SPIR-V loaded at startup, written by the post build step. with shaderHotReload it is also
+	//rebuilt at startup when shaderDirectory holds newer files
+	std::string shaderArchivePath{ "Engine/src/shaders/shaders.pak" };
+	std::string shaderDirectory	 { "Engine/src/shaders/spirv" };
+	//recompile changed GLSL from shaderSourceDirectory and swap the affected pipelines, windowed runs only
+	std::string shaderSourceDirectory{ "Engine/src/shaders/src" };
+	bool shaderHotReload{ true };
+	//draw geometry with VK_POLYGON_MODE_LINE
+	bool wireframe		{ true	};
+	//subgroups per 2D compute workgroup, the workgroup size itself comes from the device's subgroup size
+	uint computeWavesPerGroup{ 4 };
+	//pixel size of the background grid cells
+	uint backgroundGridSize{ 16 };
+};
+
+struct PendingReadback
+{
+	AllocatedBuffer  buffer;
+	VkExtent3D		 extent;
+	VkFormat		 format;
+	uint			 frameNumber;
+	ReadbackCallback callback;
+};
+
+struct PendingGeometryFree
+{
+	uint64_t	  frameTimelineValue;
+	GeometryRange range;
+};
+
+struct RetiredSwapChain
+{
+	uint64_t				 frameTimelineValue;
+	VkSwapchainKHR			 swapchain;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkSemaphore> signalSemaphores;
+};
 
 struct FrameData
 {
-	VkCommandPool	commandPool;
-	VkCommandBuffer commandBuffer;
-	VkFence		    vkFence;
-	VkSemaphore		swapchainSemaphore;
-	DeletionQueue	deletionQueue;
+	VkCommandPool				 commandPool;
+	VkCommandBuffer				 commandBuffer;
+	//only created when async compute runs on its own queue family
+	VkCommandPool				 computeCommandPool{ nullptr };
+	VkCommandBuffer				 computeCommandBuffer{ nullptr };
+	//value of mFrameTimeline signaled by the last submission using this frame
+	uint64_t					 timelineValue{ 0 };
+	VkSemaphore					 swapchainSemaphore;
+	DeletionQueue				 deletionQueue;
+	std::vector<PendingReadback> readbacks;
+	//the depth target is a graph transient, its sampled descriptor follows the view the graph hands out
+	BindlessHandle				 depthHandle{ INVALID_BINDLESS_HANDLE };
+	VkImageView					 depthView{ VK_NULL_HANDLE };
 };
 
 struct SDL_Window;
@@ -24,31 +120,70 @@ class KEngine
 {
 public:
 	KEngine(uint width, uint height);
+	KEngine(const EngineConfig& config);
 	~KEngine();
 	void init();
 	void cleanUp();
 	void run();
 	void draw();
-	MeshBuffer loadMeshBuffer(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	//copy the next rendered frame to host memory, callback fires once the gpu finished that frame
+	void requestReadback(ReadbackCallback&& callback);
+	void setFramesInFlight(uint count);
+	//meshletData is uploaded right behind the indices so it moves with them
+	MeshBuffer loadMeshBuffer(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& meshletData = {});
+	void freeMeshBuffer(MeshBuffer& meshBuffer);
 private:
 	void initWindow();
 	void initVulkan();
 	void initSwapChain();
+	void buildSwapChain(VkSwapchainKHR oldSwapChain);
+	void recreateSwapChain();
+	void initDrawImages();
+	void createDrawImages(VkExtent2D extent);
+	void destroyDrawImages();
 	void destroySwapChain();
+	void destroyRetiredSwapChains(bool all);
+	void runHeadless();
+	void recordReadbacks(VkCommandBuffer cmd);
+	void resolveReadbacks(FrameData& frame);
 	void initCommand();
-	void initImmediateCommand();
+	void initUploadManager();
+	void initGeometryBuffer();
+	//releases freed ranges the gpu is done with and compacts the buffer when it got fragmented
+	void updateGeometryBuffer(VkCommandBuffer cmd);
+	void initScene();
+	//one object per mesh surface, rebuilt whenever the geometry ranges move
+	void buildScene();
 	void initSyncStructures();
-	void initDescriptorSetLayout();
-	void initDescriptorSet();
+	void initProfiler();
+	void initBindlessHeap();
+	void writeDrawImageDescriptor();
+	void initShaders();
 	void initPipeline();
+	//applies shaders the watcher recompiled and swaps in rebuilt pipelines
+	void updateShaders();
 	void initComputePipeline();
 	void initGraphicPipeline();
 	FrameData& currentFrame();
-	void drawBackground();
-	void drawGeometry();
-	void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
+	uint currentFrameIndex() const;
+	bool hasAsyncCompute() const { return mComputeQueueFamilyIndex != mQueueFamilyIndex; }
+	//returns the mComputeTimeline value the graphics submission has to wait for
+	uint64_t submitAsyncCompute(VkCommandBuffer cmd);
+	void waitForFrame(FrameData& frame);
+	void waitForAllFrames();
+	void drawBackground(VkCommandBuffer cmd);
+	glm::mat4 viewMatrix() const;
+	glm::mat4 viewProjection() const;
+	void generateDrawCommands(VkCommandBuffer cmd, CullPhase phase);
+	void updateCullView(VkCommandBuffer cmd);
+	void cullMeshlets(VkCommandBuffer cmd);
+	bool drawMeshTasks() const { return mConfig.meshletCulling && mMeshShaders; }
+	void buildDepthPyramid(VkCommandBuffer cmd, VkImageView depthView);
+	//the late occlusion pass loads the depth the early one drew
+	void drawGeometry(VkCommandBuffer cmd, VkImageView depthView, VkAttachmentLoadOp depthLoadOp);
 	void initDefaultData();
 private:
+	EngineConfig							   mConfig;
 	bool									   mInitialized		{ false     };
 	uint									   mFrameCounter	{ 0		    };
 	SDL_Window*								   mWindow			{ nullptr   };
@@ -56,42 +191,77 @@ private:
 	VkDebugUtilsMessengerEXT				   mDebugMessage	{ nullptr   };
 	VkPhysicalDevice						   mPhysicalDevice	{ nullptr   };
 	VkDevice								   mDevice		    { nullptr   };
+	//VK_EXT_mesh_shader enabled, its draw command is not exported by the loader
+	bool									   mMeshShaders		{ false		};
+	PFN_vkCmdDrawMeshTasksEXT				   mCmdDrawMeshTasks{ nullptr	};
+	//maxComputeWorkGroupCount[0], the width of the meshlet cull dispatch
+	uint32_t								   mMeshletDispatchWidth{ 65535 };
 	VkExtent2D								   mWindowExtent	{ 1280, 720 };
 	bool									   mStopRendering	{ false		};
+	bool									   mResizeRequested	{ false		};
 	VkSurfaceKHR							   mVkSurface		{ nullptr	};
 	VkSwapchainKHR							   mVkSwapChain		{ nullptr	};
 	std::vector<VkImage>					   mSwapChainImages;
 	std::vector<VkImageView>				   mSwapChainImageViews;
 	VkExtent2D								   mSwapChainExtent;
 	VkFormat								   mSwapChainImageFormat;
-	FrameData								   mFrameData[FRAME_OVERLAP];
+	FrameData								   mFrameData[MAX_FRAMES_IN_FLIGHT];
+	uint									   mFramesInFlight	{ 2			};
+	VkSemaphore								   mFrameTimeline	{ nullptr	};
+	uint64_t								   mFrameTimelineValue{ 0		};
 	VkQueue									   mQueue			{ nullptr	};
 	uint 									   mQueueFamilyIndex { 0			};
+	//same as mQueue when the device has no separate compute family
+	VkQueue									   mComputeQueue	{ nullptr	};
+	uint									   mComputeQueueFamilyIndex{ 0	};
+	VkSemaphore								   mComputeTimeline	{ nullptr	};
+	uint64_t								   mComputeTimelineValue{ 0	};
+	//same as mQueue when the device has no separate transfer family
+	VkQueue									   mTransferQueue	{ nullptr	};
+	uint									   mTransferQueueFamilyIndex{ 0	};
+	//families sharing mesh buffers CONCURRENT
+	std::vector<uint32_t>					   mMeshQueueFamilies;
+	UploadManager							   mUploadManager;
+	GeometryBuffer							   mGeometryBuffer;
+	std::vector<PendingGeometryFree>		   mGeometryFrees;
+	GpuScene								   mScene;
+	//upload timeline value the current frame waits on, meshes with a later ticket are skipped
+	uint64_t								   mFrameUploadValue{ 0 };
 	std::vector<VkSemaphore>				   mSignalSemaphores;
-	uint									   mSwapChainImageCount;
+	std::vector<RetiredSwapChain>			   mRetiredSwapChains;
+	uint									   mSwapChainImageCount{ 0 };
 											   
 	//vma									   
 	VmaAllocator							   mMemAllocator{ nullptr };
 	AllocatedImage							   mDrawColorImage;
-	AllocatedImage							   mDrawDepthImage;
+	//persistent rather than a graph transient so the depth pyramid can sample it through the heap
+	VkFormat								   mDrawDepthFormat{ VK_FORMAT_D32_SFLOAT };
+	DepthPyramid							   mDepthPyramid;
+	//rendered region of the draw images, they are allocated larger so resizes don't reallocate
+	VkExtent2D								   mDrawExtent		{ 0, 0		};
 	DeletionQueue							   mMainDeletionQueue;
 											   
 											   
-	//descriptorSetlayout & se				   t & pool
-	VkDescriptorPool						   mDescriptorPool{ nullptr };	
-	VkDescriptorSetLayout					   mComputeDescriptorSetLayout{ nullptr };
-	VkDescriptorSet							   mComputeDescriptorSet{ nullptr };
-											   
-	//compute pipeline						   
-	VkPipelineLayout						   mComputePipelineLayout{ nullptr };
-	VkPipeline								   mComputePipeline{ nullptr };
+	//every shader resource lives in the bindless heap, all pipelines use its layout
+	BindlessHeap							   mBindlessHeap;
+	BindlessHandle							   mDrawColorHandle{ INVALID_BINDLESS_HANDLE };
 											   
-	//graphic pipeline						   
-	VkPipelineLayout						   mGraphicPipelineLayout;
-	VkPipeline								   mGraphicPipeline;
+	ShaderArchive							   mShaderArchive;
+	ShaderModuleCache						   mShaderModules;
+	ShaderWatcher							   mShaderWatcher;
+	std::vector<ShaderWatcher::CompiledShader> mCompiledShaders;
+	PipelineCache							   mPipelineCache;
+	ComputeTuning							   mComputeTuning;
+	PipelineManager							   mPipelines;
+	PipelineHandle							   mBackgroundPipeline{ INVALID_PIPELINE_HANDLE };
+	PipelineHandle							   mGeometryPipeline{ INVALID_PIPELINE_HANDLE };
+	PipelineHandle							   mDrawCommandPipeline{ INVALID_PIPELINE_HANDLE };
+	PipelineHandle							   mDepthReducePipeline{ INVALID_PIPELINE_HANDLE };
+	PipelineHandle							   mMeshletCullPipeline{ INVALID_PIPELINE_HANDLE };
+	PipelineHandle							   mMeshletPipeline{ INVALID_PIPELINE_HANDLE };
 											   
-	VkCommandPool							   mImmediateSubmitPool{ nullptr };
-	VkCommandBuffer							   mImmediateSubmitCmd{ nullptr };
-	VkFence									   mImmediateSubmitFence{ nullptr };
 	std::vector<std::shared_ptr<MeshAssert>>   mMeshes;
+	std::vector<ReadbackCallback>			   mReadbackRequests;
+	GpuProfiler								   mGpuProfiler;
+	RenderGraph								   mRenderGraph;
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "computeTuning.h"
+#include "core.h"
+
+namespace
+{
+	uint32_t floorPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value)
+		{
+			result *= 2;
+		}
+		return result;
+	}
+}
+
+void ComputeTuning::init(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceVulkan11Properties properties11{};
+	properties11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties11;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+	const VkPhysicalDeviceLimits& limits = properties.properties.limits;
+	mSubgroupSize = std::max(properties11.subgroupSize, 1u);
+	mMaxInvocations = limits.maxComputeWorkGroupInvocations;
+	for (int i = 0; i < 3; i++)
+	{
+		mMaxSize[i] = limits.maxComputeWorkGroupSize[i];
+	}
+	KS_CORE_INFO("Compute: subgroup size {}, at most {} invocations per workgroup", mSubgroupSize, mMaxInvocations);
+}
+
+VkExtent3D ComputeTuning::workgroup2D(uint32_t wavesPerGroup) const
+{
+	uint32_t invocations = floorPowerOfTwo(std::clamp(mSubgroupSize * std::max(wavesPerGroup, 1u), 1u, mMaxInvocations));
+	//wider than tall when the count is an odd power, rows stay contiguous in memory
+	uint32_t width = 1;
+	while (width * width < invocations)
+	{
+		width *= 2;
+	}
+	width = std::min(width, floorPowerOfTwo(mMaxSize[0]));
+	uint32_t height = std::min(std::max(invocations / width, 1u), floorPowerOfTwo(mMaxSize[1]));
+	return VkExtent3D{ width, height, 1 };
+}
+
+VkExtent3D ComputeTuning::workgroup1D(uint32_t wavesPerGroup) const
+{
+	uint32_t invocations = std::clamp(mSubgroupSize * std::max(wavesPerGroup, 1u), 1u, std::min(mMaxInvocations, mMaxSize[0]));
+	return VkExtent3D{ invocations, 1, 1 };
+}
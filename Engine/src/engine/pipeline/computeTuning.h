@@ -0,0 +1,18 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+//device numbers compute workgroup sizes are picked from, the sizes reach the shaders as specialization constants
+class ComputeTuning
+{
+public:
+	void init(VkPhysicalDevice physicalDevice);
+	//power of two 2D workgroup of wavesPerGroup subgroups, as square as the device limits allow
+	VkExtent3D workgroup2D(uint32_t wavesPerGroup) const;
+	//wavesPerGroup subgroups in a row, for passes over flat lists
+	VkExtent3D workgroup1D(uint32_t wavesPerGroup) const;
+	uint32_t subgroupSize() const { return mSubgroupSize; }
+private:
+	uint32_t mSubgroupSize{ 32 };
+	uint32_t mMaxInvocations{ 128 };
+	uint32_t mMaxSize[3]{ 128, 128, 64 };
+};
@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <cstddef>
+#include "pipelineBuilder.h"
+#include "core.h"
+#include "../utils.h"
+
+namespace
+{
+	//hashes each field separately so struct padding never reaches the hash
+	struct Hasher
+	{
+		uint64_t value{ Utils::HASH_SEED };
+		void add(const void* data, size_t size)
+		{
+			value = Utils::hashBytes(data, size, value);
+		}
+		template<typename T>
+		void add(const T& field)
+		{
+			add(&field, sizeof(T));
+		}
+		void add(const std::string& text)
+		{
+			add(text.size());
+			add(text.data(), text.size());
+		}
+	};
+
+	VkPipelineShaderStageCreateInfo createStageInfo(VkShaderStageFlagBits stage, VkShaderModule module)
+	{
+		VkPipelineShaderStageCreateInfo stageInfo{};
+		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stageInfo.pNext = nullptr;
+		stageInfo.flags = 0;
+		stageInfo.stage = stage;
+		stageInfo.module = module;
+		stageInfo.pName = "main";
+		stageInfo.pSpecializationInfo = nullptr;
+		return stageInfo;
+	}
+}
+
+bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const
+{
+	return vertexShader == other.vertexShader && taskShader == other.taskShader && meshShader == other.meshShader &&
+		fragmentShader == other.fragmentShader && topology == other.topology &&
+		polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+		depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompareOp == other.depthCompareOp &&
+		blendMode == other.blendMode && colorFormats == other.colorFormats && depthFormat == other.depthFormat && layout == other.layout;
+}
+
+uint64_t GraphicsPipelineDesc::hash() const
+{
+	Hasher hasher;
+	hasher.add(vertexShader);
+	hasher.add(taskShader);
+	hasher.add(meshShader);
+	hasher.add(fragmentShader);
+	hasher.add(topology);
+	hasher.add(polygonMode);
+	hasher.add(cullMode);
+	hasher.add(frontFace);
+	hasher.add(depthTest);
+	hasher.add(depthWrite);
+	hasher.add(depthCompareOp);
+	hasher.add(blendMode);
+	hasher.add(colorFormats.size());
+	for (VkFormat format : colorFormats)
+	{
+		hasher.add(format);
+	}
+	hasher.add(depthFormat);
+	hasher.add(layout);
+	return hasher.value;
+}
+
+bool ComputePipelineDesc::operator==(const ComputePipelineDesc& other) const
+{
+	return computeShader == other.computeShader && layout == other.layout && workgroupSize.width == other.workgroupSize.width &&
+		workgroupSize.height == other.workgroupSize.height && workgroupSize.depth == other.workgroupSize.depth && constants == other.constants;
+}
+
+uint64_t ComputePipelineDesc::hash() const
+{
+	Hasher hasher;
+	hasher.add(computeShader);
+	hasher.add(layout);
+	hasher.add(workgroupSize.width);
+	hasher.add(workgroupSize.height);
+	hasher.add(workgroupSize.depth);
+	hasher.add(constants.size());
+	for (const SpecializationConstant& constant : constants)
+	{
+		hasher.add(constant.id);
+		hasher.add(constant.value);
+	}
+	return hasher.value;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setShaders(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	mDesc.vertexShader = vertexShader;
+	mDesc.taskShader.clear();
+	mDesc.meshShader.clear();
+	mDesc.fragmentShader = fragmentShader;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setMeshShaders(const std::string& taskShader, const std::string& meshShader, const std::string& fragmentShader)
+{
+	mDesc.vertexShader.clear();
+	mDesc.taskShader = taskShader;
+	mDesc.meshShader = meshShader;
+	mDesc.fragmentShader = fragmentShader;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setTopology(VkPrimitiveTopology topology)
+{
+	mDesc.topology = topology;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setPolygonMode(VkPolygonMode polygonMode)
+{
+	mDesc.polygonMode = polygonMode;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace)
+{
+	mDesc.cullMode = cullMode;
+	mDesc.frontFace = frontFace;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::enableDepthTest(bool depthWrite, VkCompareOp compareOp)
+{
+	mDesc.depthTest = true;
+	mDesc.depthWrite = depthWrite;
+	mDesc.depthCompareOp = compareOp;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::disableDepthTest()
+{
+	mDesc.depthTest = false;
+	mDesc.depthWrite = false;
+	mDesc.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setBlendMode(BlendMode blendMode)
+{
+	mDesc.blendMode = blendMode;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::addColorFormat(VkFormat format)
+{
+	mDesc.colorFormats.push_back(format);
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setDepthFormat(VkFormat format)
+{
+	mDesc.depthFormat = format;
+	return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setLayout(VkPipelineLayout layout)
+{
+	mDesc.layout = layout;
+	return *this;
+}
+
+VkPipeline GraphicsPipelineBuilder::build(VkDevice device, VkPipelineCache cache, const GraphicsPipelineDesc& desc,
+	const GraphicsShaderModules& modules, const void* pNext)
+{
+	bool meshPipeline = !desc.meshShader.empty();
+	VkPipelineShaderStageCreateInfo stages[3];
+	uint32_t stageCount = 0;
+	if (meshPipeline)
+	{
+		if (modules.task)
+		{
+			stages[stageCount++] = createStageInfo(VK_SHADER_STAGE_TASK_BIT_EXT, modules.task);
+		}
+		stages[stageCount++] = createStageInfo(VK_SHADER_STAGE_MESH_BIT_EXT, modules.mesh);
+	}
+	else
+	{
+		stages[stageCount++] = createStageInfo(VK_SHADER_STAGE_VERTEX_BIT, modules.vertex);
+	}
+	stages[stageCount++] = createStageInfo(VK_SHADER_STAGE_FRAGMENT_BIT, modules.fragment);
+
+	std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(desc.colorFormats.size());
+	for (auto& blendAttachment : blendAttachments)
+	{
+		blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		blendAttachment.blendEnable = desc.blendMode != BlendMode::None;
+		blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		blendAttachment.dstColorBlendFactor = desc.blendMode == BlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	}
+	VkPipelineColorBlendStateCreateInfo blend{};
+	blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blend.pNext = nullptr;
+	blend.flags = 0;
+	blend.logicOpEnable = VK_FALSE;
+	blend.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+	blend.pAttachments = blendAttachments.data();
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilState{};
+	depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilState.depthTestEnable = desc.depthTest;
+	depthStencilState.depthWriteEnable = desc.depthWrite;
+	depthStencilState.depthCompareOp = desc.depthCompareOp;
+	depthStencilState.minDepthBounds = 0.0f;
+	depthStencilState.maxDepthBounds = 1.0f;
+	depthStencilState.stencilTestEnable = VK_FALSE;
+
+	VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.pNext = nullptr;
+	dynamicState.flags = 0;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineInputAssemblyStateCreateInfo assembly{};
+	assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assembly.pNext = nullptr;
+	assembly.flags = 0;
+	assembly.topology = desc.topology;
+	assembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo msInfo{};
+	msInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	msInfo.pNext = nullptr;
+	msInfo.flags = 0;
+	msInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	msInfo.sampleShadingEnable = VK_FALSE;
+	msInfo.alphaToCoverageEnable = VK_FALSE;
+	msInfo.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo{};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.pNext = nullptr;
+	rasterInfo.flags = 0;
+	rasterInfo.polygonMode = desc.polygonMode;
+	rasterInfo.cullMode = desc.cullMode;
+	rasterInfo.frontFace = desc.frontFace;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.lineWidth = 1.0f;
+
+	//viewport and scissor are dynamic
+	VkPipelineViewportStateCreateInfo viewPortInfo{};
+	viewPortInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewPortInfo.pNext = nullptr;
+	viewPortInfo.flags = 0;
+	viewPortInfo.viewportCount = 1;
+	viewPortInfo.scissorCount = 1;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.pNext = pNext;
+	renderingInfo.viewMask = 0;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(desc.colorFormats.size());
+	renderingInfo.pColorAttachmentFormats = desc.colorFormats.data();
+	renderingInfo.depthAttachmentFormat = desc.depthFormat;
+
+	//vertices are pulled through buffer device addresses
+	VkPipelineVertexInputStateCreateInfo inputInfo{};
+	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	inputInfo.flags = 0;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.flags = 0;
+	pipelineInfo.stageCount = stageCount;
+	pipelineInfo.pStages = stages;
+	//mesh pipelines have no vertex input stage
+	pipelineInfo.pVertexInputState = meshPipeline ? nullptr : &inputInfo;
+	pipelineInfo.pInputAssemblyState = meshPipeline ? nullptr : &assembly;
+	pipelineInfo.pTessellationState = nullptr;
+	pipelineInfo.pViewportState = &viewPortInfo;
+	pipelineInfo.pRasterizationState = &rasterInfo;
+	pipelineInfo.pMultisampleState = &msInfo;
+	pipelineInfo.pDepthStencilState = &depthStencilState;
+	pipelineInfo.pColorBlendState = &blend;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = desc.layout;
+	pipelineInfo.renderPass = nullptr;
+
+	VkPipeline pipeline = nullptr;
+	VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline));
+	return pipeline;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setShader(const std::string& computeShader)
+{
+	mDesc.computeShader = computeShader;
+	return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setLayout(VkPipelineLayout layout)
+{
+	mDesc.layout = layout;
+	return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setWorkgroupSize(VkExtent3D workgroupSize)
+{
+	mDesc.workgroupSize = workgroupSize;
+	return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setConstant(uint32_t id, uint32_t value)
+{
+	KS_CORE_ASSERT(id >= FIRST_USER_CONSTANT_ID, "Specialization constant id is reserved for the workgroup size");
+	auto iter = std::find_if(mDesc.constants.begin(), mDesc.constants.end(), [id](const SpecializationConstant& constant) { return constant.id == id; });
+	if (iter != mDesc.constants.end())
+	{
+		iter->value = value;
+		return *this;
+	}
+	mDesc.constants.push_back(SpecializationConstant{ id, value });
+	return *this;
+}
+
+VkPipeline ComputePipelineBuilder::build(VkDevice device, VkPipelineCache cache, const ComputePipelineDesc& desc, VkShaderModule computeModule, const void* pNext)
+{
+	//the workgroup size goes first so its ids line up with the entries, shaders ignore ids they don't declare
+	std::vector<SpecializationConstant> constants;
+	constants.reserve(desc.constants.size() + 3);
+	constants.push_back(SpecializationConstant{ WORKGROUP_SIZE_CONSTANT_ID, desc.workgroupSize.width });
+	constants.push_back(SpecializationConstant{ WORKGROUP_SIZE_CONSTANT_ID + 1, desc.workgroupSize.height });
+	constants.push_back(SpecializationConstant{ WORKGROUP_SIZE_CONSTANT_ID + 2, desc.workgroupSize.depth });
+	constants.insert(constants.end(), desc.constants.begin(), desc.constants.end());
+	std::vector<VkSpecializationMapEntry> mapEntries(constants.size());
+	for (size_t i = 0; i < constants.size(); i++)
+	{
+		mapEntries[i].constantID = constants[i].id;
+		mapEntries[i].offset = static_cast<uint32_t>(i * sizeof(SpecializationConstant) + offsetof(SpecializationConstant, value));
+		mapEntries[i].size = sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+	specializationInfo.pMapEntries = mapEntries.data();
+	specializationInfo.dataSize = constants.size() * sizeof(SpecializationConstant);
+	specializationInfo.pData = constants.data();
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.pNext = pNext;
+	computePipelineInfo.flags = 0;
+	computePipelineInfo.stage = createStageInfo(VK_SHADER_STAGE_COMPUTE_BIT, computeModule);
+	computePipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+	computePipelineInfo.layout = desc.layout;
+
+	VkPipeline pipeline = nullptr;
+	VK_CHECK(vkCreateComputePipelines(device, cache, 1, &computePipelineInfo, nullptr, &pipeline));
+	return pipeline;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+enum class BlendMode
+{
+	None,
+	Alpha,
+	Additive
+};
+
+//everything a graphics pipeline is built from, two equal descriptions always produce the same pipeline
+struct GraphicsPipelineDesc
+{
+	std::string			  vertexShader;
+	//VK_EXT_mesh_shader pipelines set these instead of vertexShader, taskShader is optional
+	std::string			  taskShader;
+	std::string			  meshShader;
+	std::string			  fragmentShader;
+	VkPrimitiveTopology	  topology		 { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+	VkPolygonMode		  polygonMode	 { VK_POLYGON_MODE_FILL };
+	VkCullModeFlags		  cullMode		 { VK_CULL_MODE_NONE };
+	VkFrontFace			  frontFace		 { VK_FRONT_FACE_COUNTER_CLOCKWISE };
+	bool				  depthTest		 { false };
+	bool				  depthWrite	 { false };
+	VkCompareOp			  depthCompareOp { VK_COMPARE_OP_ALWAYS };
+	BlendMode			  blendMode		 { BlendMode::None };
+	std::vector<VkFormat> colorFormats;
+	VkFormat			  depthFormat	 { VK_FORMAT_UNDEFINED };
+	VkPipelineLayout	  layout		 { nullptr };
+	bool operator==(const GraphicsPipelineDesc& other) const;
+	uint64_t hash() const;
+};
+
+//compute shaders declare local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2,
+//their own tunables start at FIRST_USER_CONSTANT_ID
+constexpr static uint32_t WORKGROUP_SIZE_CONSTANT_ID = 0;
+constexpr static uint32_t FIRST_USER_CONSTANT_ID	 = 3;
+
+//32 bit scalar specialization constant
+struct SpecializationConstant
+{
+	uint32_t id;
+	uint32_t value;
+	bool operator==(const SpecializationConstant& other) const { return id == other.id && value == other.value; }
+};
+
+struct ComputePipelineDesc
+{
+	std::string							computeShader;
+	VkPipelineLayout					layout{ nullptr };
+	//specialized into the shader, dispatch sizes are derived from it
+	VkExtent3D							workgroupSize{ 1, 1, 1 };
+	std::vector<SpecializationConstant> constants;
+	bool operator==(const ComputePipelineDesc& other) const;
+	uint64_t hash() const;
+};
+
+//modules of the stages a GraphicsPipelineDesc names, the others stay null
+struct GraphicsShaderModules
+{
+	VkShaderModule vertex  { nullptr };
+	VkShaderModule task	   { nullptr };
+	VkShaderModule mesh	   { nullptr };
+	VkShaderModule fragment{ nullptr };
+};
+
+class GraphicsPipelineBuilder
+{
+public:
+	GraphicsPipelineBuilder& setShaders(const std::string& vertexShader, const std::string& fragmentShader);
+	GraphicsPipelineBuilder& setMeshShaders(const std::string& taskShader, const std::string& meshShader, const std::string& fragmentShader);
+	GraphicsPipelineBuilder& setTopology(VkPrimitiveTopology topology);
+	GraphicsPipelineBuilder& setPolygonMode(VkPolygonMode polygonMode);
+	GraphicsPipelineBuilder& setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace);
+	GraphicsPipelineBuilder& enableDepthTest(bool depthWrite, VkCompareOp compareOp);
+	GraphicsPipelineBuilder& disableDepthTest();
+	GraphicsPipelineBuilder& setBlendMode(BlendMode blendMode);
+	GraphicsPipelineBuilder& addColorFormat(VkFormat format);
+	GraphicsPipelineBuilder& setDepthFormat(VkFormat format);
+	GraphicsPipelineBuilder& setLayout(VkPipelineLayout layout);
+	const GraphicsPipelineDesc& desc() const { return mDesc; }
+	//modules must match the shaders named in desc
+	static VkPipeline build(VkDevice device, VkPipelineCache cache, const GraphicsPipelineDesc& desc,
+		const GraphicsShaderModules& modules, const void* pNext);
+private:
+	GraphicsPipelineDesc mDesc;
+};
+
+class ComputePipelineBuilder
+{
+public:
+	ComputePipelineBuilder& setShader(const std::string& computeShader);
+	ComputePipelineBuilder& setLayout(VkPipelineLayout layout);
+	ComputePipelineBuilder& setWorkgroupSize(VkExtent3D workgroupSize);
+	//id must be at least FIRST_USER_CONSTANT_ID, setting an id again overwrites its value
+	ComputePipelineBuilder& setConstant(uint32_t id, uint32_t value);
+	const ComputePipelineDesc& desc() const { return mDesc; }
+	static VkPipeline build(VkDevice device, VkPipelineCache cache, const ComputePipelineDesc& desc, VkShaderModule computeModule, const void* pNext);
+private:
+	ComputePipelineDesc mDesc;
+};
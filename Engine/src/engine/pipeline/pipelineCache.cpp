@@ -0,0 +1,164 @@
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include "pipelineCache.h"
+#include "core.h"
+#include "../utils.h"
+#include "../profiler/cpuProfiler.h"
+
+namespace
+{
+	constexpr uint32_t CACHE_FILE_MAGIC = 0x4B535043; //KSPC
+	constexpr uint32_t CACHE_FILE_VERSION = 1;
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader() const
+{
+	FileHeader header{};
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.vendorID = mProperties.vendorID;
+	header.deviceID = mProperties.deviceID;
+	header.driverVersion = mProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
+
+void PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path)
+{
+	KS_PROFILE_FUNCTION();
+	mDevice = device;
+	mPath = path;
+	vkGetPhysicalDeviceProperties(physicalDevice, &mProperties);
+
+	std::vector<char> data;
+	if (!mPath.empty())
+	{
+		std::ifstream file(mPath, std::ios::ate | std::ios::binary);
+		if (file.is_open())
+		{
+			size_t fileSize = static_cast<size_t>(file.tellg());
+			FileHeader header{};
+			FileHeader expected = makeHeader();
+			file.seekg(0);
+			if (fileSize >= sizeof(FileHeader))
+			{
+				file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+			}
+			bool valid = fileSize >= sizeof(FileHeader) && header.magic == expected.magic && header.version == expected.version &&
+				header.dataSize == fileSize - sizeof(FileHeader);
+			bool sameDevice = header.vendorID == expected.vendorID && header.deviceID == expected.deviceID &&
+				header.driverVersion == expected.driverVersion && memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+			if (valid && sameDevice)
+			{
+				data.resize(header.dataSize);
+				file.read(data.data(), data.size());
+				if (!file || Utils::hashBytes(data.data(), data.size()) != header.dataHash)
+				{
+					KS_CORE_WARN("Pipeline cache {} is corrupted, starting empty", mPath);
+					data.clear();
+				}
+			}
+			else if (valid)
+			{
+				KS_CORE_INFO("Pipeline cache {} was written by another device or driver, starting empty", mPath);
+			}
+			else
+			{
+				KS_CORE_WARN("Pipeline cache {} has an unknown format, starting empty", mPath);
+			}
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.pNext = nullptr;
+	cacheInfo.flags = 0;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+	VK_CHECK(vkCreatePipelineCache(mDevice, &cacheInfo, nullptr, &mCache));
+	mLoaded = !data.empty();
+	if (mLoaded)
+	{
+		KS_CORE_INFO("Pipeline cache loaded from {} ({} KB)", mPath, data.size() / 1024);
+	}
+}
+
+void PipelineCache::destroy()
+{
+	KS_CORE_INFO("Pipeline cache: {} hits, {} misses", mHits.load(), mMisses.load());
+	if (!mLoaded || mMisses > 0)
+	{
+		save();
+	}
+	vkDestroyPipelineCache(mDevice, mCache, nullptr);
+	mCache = nullptr;
+}
+
+bool PipelineCache::save()
+{
+	if (mPath.empty())
+	{
+		return false;
+	}
+	KS_PROFILE_FUNCTION();
+	size_t dataSize = 0;
+	VK_CHECK(vkGetPipelineCacheData(mDevice, mCache, &dataSize, nullptr));
+	std::vector<char> data(dataSize);
+	VK_CHECK(vkGetPipelineCacheData(mDevice, mCache, &dataSize, data.data()));
+	data.resize(dataSize);
+	FileHeader header = makeHeader();
+	header.dataSize = dataSize;
+	header.dataHash = Utils::hashBytes(data.data(), data.size());
+
+	//write next to the target and rename over it, a crash mid write never leaves a torn cache behind
+	std::string tmpPath = mPath + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			KS_CORE_ERROR("Failed to open {} for writing", tmpPath);
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+		file.write(data.data(), data.size());
+		file.flush();
+		if (!file)
+		{
+			KS_CORE_ERROR("Failed to write pipeline cache {}", tmpPath);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tmpPath, mPath, error);
+	if (error)
+	{
+		KS_CORE_ERROR("Failed to replace pipeline cache {}: {}", mPath, error.message());
+		std::filesystem::remove(tmpPath, error);
+		return false;
+	}
+	KS_CORE_INFO("Pipeline cache saved to {} ({} KB)", mPath, dataSize / 1024);
+	return true;
+}
+
+void PipelineCache::recordFeedback(const char* pipelineName, const PipelineFeedback& feedback)
+{
+	const VkPipelineCreationFeedback& result = feedback.feedback;
+	if (!(result.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT))
+	{
+		//driver gave no feedback, count it as compiled so the cache still gets written
+		mMisses++;
+		return;
+	}
+	bool hit = result.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT;
+	if (hit)
+	{
+		mHits++;
+	}
+	else
+	{
+		mMisses++;
+	}
+	KS_CORE_TRACE("Pipeline {}: cache {}, {:.3f} ms", pipelineName, hit ? "hit" : "miss", result.duration / 1000000.0);
+}
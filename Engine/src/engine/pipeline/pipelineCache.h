@@ -0,0 +1,59 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <string>
+
+//creation feedback for one pipeline, chain info into the pipeline create info's pNext
+struct PipelineFeedback
+{
+	PipelineFeedback()
+	{
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+		info.pNext = nullptr;
+		info.pPipelineCreationFeedback = &feedback;
+		info.pipelineStageCreationFeedbackCount = 0;
+		info.pPipelineStageCreationFeedbacks = nullptr;
+	}
+	PipelineFeedback(const PipelineFeedback&) = delete;
+	PipelineFeedback& operator=(const PipelineFeedback&) = delete;
+	VkPipelineCreationFeedback			 feedback{};
+	VkPipelineCreationFeedbackCreateInfo info{};
+};
+
+//VkPipelineCache persisted to disk between runs. The file carries its own header so a cache
+//written by another device or driver version is thrown away instead of handed to the driver
+class PipelineCache
+{
+public:
+	//an empty path keeps the cache in memory only
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+	//saves when pipelines were compiled this run, then destroys the cache
+	void destroy();
+	bool save();
+	void recordFeedback(const char* pipelineName, const PipelineFeedback& feedback);
+	VkPipelineCache handle() const { return mCache; }
+	uint32_t hitCount() const { return mHits; }
+	uint32_t missCount() const { return mMisses; }
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t	 pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+	FileHeader makeHeader() const;
+private:
+	VkDevice			  mDevice{ nullptr };
+	VkPipelineCache		  mCache{ nullptr };
+	std::string			  mPath;
+	VkPhysicalDeviceProperties mProperties{};
+	std::atomic<uint32_t> mHits{ 0 };
+	std::atomic<uint32_t> mMisses{ 0 };
+	//nothing new to write when every pipeline came out of the loaded cache
+	bool				  mLoaded{ false };
+};
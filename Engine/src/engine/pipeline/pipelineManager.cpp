@@ -0,0 +1,275 @@
+#include <algorithm>
+#include "pipelineManager.h"
+#include "pipelineCache.h"
+#include "core.h"
+#include "../shader/shaderModuleCache.h"
+#include "../profiler/cpuProfiler.h"
+
+void PipelineManager::init(VkDevice device, PipelineCache* cache, ShaderModuleCache* shaderModules, uint32_t workerCount)
+{
+	mDevice = device;
+	mCache = cache;
+	mShaderModules = shaderModules;
+	mStopping = false;
+	for (uint32_t i = 0; i < std::max(workerCount, 1u); i++)
+	{
+		mWorkers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+void PipelineManager::destroy()
+{
+	{
+		//queued jobs are dropped, a compile already running finishes before its worker joins
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+		mJobs.clear();
+	}
+	mWorkAvailable.notify_all();
+	for (auto& worker : mWorkers)
+	{
+		worker.join();
+	}
+	mWorkers.clear();
+	for (auto& entry : mEntries)
+	{
+		vkDestroyPipeline(mDevice, entry.pipeline, nullptr);
+		vkDestroyPipeline(mDevice, entry.replacement, nullptr);
+	}
+	KS_CORE_INFO("Pipelines: {} compiled, {} requests deduplicated, {} fallback draws, {} skipped draws",
+		mEntries.size(), mDedupCount, mFallbackCount, mSkipCount);
+	mEntries.clear();
+	mLookup.clear();
+	mRegistered.clear();
+	mRebuilding.clear();
+}
+
+PipelineHandle PipelineManager::findOrAdd(const char* name, uint64_t hash, const GraphicsPipelineDesc* graphics, const ComputePipelineDesc* compute, PipelineHandle fallback)
+{
+	auto range = mLookup.equal_range(hash);
+	for (auto iter = range.first; iter != range.second; iter++)
+	{
+		const Entry& existing = mEntries[iter->second];
+		bool same = compute ? existing.isCompute && existing.compute == *compute : !existing.isCompute && existing.graphics == *graphics;
+		if (same)
+		{
+			mDedupCount++;
+			return iter->second;
+		}
+	}
+	PipelineHandle handle = static_cast<PipelineHandle>(mEntries.size());
+	Entry& entry = mEntries.emplace_back();
+	entry.name = name;
+	entry.hash = hash;
+	entry.isCompute = compute != nullptr;
+	if (compute)
+	{
+		entry.compute = *compute;
+	}
+	else
+	{
+		entry.graphics = *graphics;
+	}
+	entry.fallback = fallback;
+	mLookup.emplace(hash, handle);
+	mRegistered.push_back(handle);
+	return handle;
+}
+
+PipelineHandle PipelineManager::request(const GraphicsPipelineBuilder& builder, const char* name, PipelineHandle fallback)
+{
+	return findOrAdd(name, builder.desc().hash(), &builder.desc(), nullptr, fallback);
+}
+
+PipelineHandle PipelineManager::request(const ComputePipelineBuilder& builder, const char* name, PipelineHandle fallback)
+{
+	return findOrAdd(name, builder.desc().hash(), nullptr, &builder.desc(), fallback);
+}
+
+void PipelineManager::enqueue(PipelineHandle handle)
+{
+	Entry& entry = mEntries[handle];
+	if (entry.state.load(std::memory_order_relaxed) != State::Registered)
+	{
+		return;
+	}
+	entry.state.store(State::Queued, std::memory_order_relaxed);
+	mJobs.push_back(Job{ &entry, false });
+	mWorkAvailable.notify_one();
+}
+
+void PipelineManager::compilePending()
+{
+	KS_PROFILE_FUNCTION();
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (PipelineHandle handle : mRegistered)
+	{
+		enqueue(handle);
+	}
+	mRegistered.clear();
+	mWorkDone.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+VkPipeline PipelineManager::acquire(PipelineHandle handle)
+{
+	Entry& entry = mEntries[handle];
+	if (entry.state.load(std::memory_order_acquire) == State::Ready)
+	{
+		return entry.pipeline;
+	}
+	if (entry.state.load(std::memory_order_relaxed) == State::Registered)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		enqueue(handle);
+		KS_CORE_TRACE("Pipeline {} requested at first use, compiling in the background", entry.name);
+	}
+	if (entry.fallback != INVALID_PIPELINE_HANDLE && isReady(entry.fallback))
+	{
+		mFallbackCount++;
+		return mEntries[entry.fallback].pipeline;
+	}
+	mSkipCount++;
+	return nullptr;
+}
+
+VkExtent3D PipelineManager::groupCount(PipelineHandle handle, VkExtent3D extent) const
+{
+	const Entry& entry = mEntries[handle];
+	KS_CORE_ASSERT(entry.isCompute, "Only compute pipelines are dispatched");
+	const VkExtent3D& size = entry.compute.workgroupSize;
+	return VkExtent3D{
+		(extent.width + size.width - 1) / size.width,
+		(extent.height + size.height - 1) / size.height,
+		(extent.depth + size.depth - 1) / size.depth
+	};
+}
+
+bool PipelineManager::usesShader(const Entry& entry, const std::string& shaderName) const
+{
+	if (entry.isCompute)
+	{
+		return entry.compute.computeShader == shaderName;
+	}
+	return entry.graphics.vertexShader == shaderName || entry.graphics.taskShader == shaderName ||
+		entry.graphics.meshShader == shaderName || entry.graphics.fragmentShader == shaderName;
+}
+
+uint32_t PipelineManager::rebuildUsing(const std::string& shaderName)
+{
+	uint32_t count = 0;
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (PipelineHandle handle = 0; handle < mEntries.size(); handle++)
+	{
+		Entry& entry = mEntries[handle];
+		//pipelines not compiled yet pick up the new module on their own
+		if (!usesShader(entry, shaderName) || entry.state.load(std::memory_order_acquire) != State::Ready)
+		{
+			continue;
+		}
+		count++;
+		if (entry.rebuilding)
+		{
+			entry.rebuildAgain = true;
+			continue;
+		}
+		entry.rebuilding = true;
+		mRebuilding.push_back(handle);
+		mJobs.push_back(Job{ &entry, true });
+		mWorkAvailable.notify_one();
+	}
+	return count;
+}
+
+void PipelineManager::swapRebuilt(DeletionQueue& retireQueue)
+{
+	for (size_t i = 0; i < mRebuilding.size();)
+	{
+		Entry& entry = mEntries[mRebuilding[i]];
+		if (!entry.replacementReady.load(std::memory_order_acquire))
+		{
+			i++;
+			continue;
+		}
+		retireQueue.push_back([device = mDevice, pipeline = entry.pipeline]() {
+			vkDestroyPipeline(device, pipeline, nullptr);
+		});
+		entry.pipeline = entry.replacement;
+		entry.replacement = nullptr;
+		entry.replacementReady.store(false, std::memory_order_relaxed);
+		KS_CORE_INFO("Pipeline {} reloaded", entry.name);
+		if (entry.rebuildAgain)
+		{
+			entry.rebuildAgain = false;
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(Job{ &entry, true });
+			mWorkAvailable.notify_one();
+			i++;
+			continue;
+		}
+		entry.rebuilding = false;
+		mRebuilding[i] = mRebuilding.back();
+		mRebuilding.pop_back();
+	}
+}
+
+bool PipelineManager::idle()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mJobs.empty() && mActiveJobs == 0 && mRebuilding.empty();
+}
+
+void PipelineManager::compile(Entry& entry, bool rebuild)
+{
+	KS_PROFILE_ZONE("compilePipeline");
+	PipelineFeedback feedback;
+	VkPipeline pipeline = nullptr;
+	if (entry.isCompute)
+	{
+		VkShaderModule computeModule = mShaderModules->get(entry.compute.computeShader);
+		pipeline = ComputePipelineBuilder::build(mDevice, mCache->handle(), entry.compute, computeModule, &feedback.info);
+	}
+	else
+	{
+		const GraphicsPipelineDesc& desc = entry.graphics;
+		GraphicsShaderModules modules;
+		modules.vertex = desc.vertexShader.empty() ? nullptr : mShaderModules->get(desc.vertexShader);
+		modules.task = desc.taskShader.empty() ? nullptr : mShaderModules->get(desc.taskShader);
+		modules.mesh = desc.meshShader.empty() ? nullptr : mShaderModules->get(desc.meshShader);
+		modules.fragment = mShaderModules->get(desc.fragmentShader);
+		pipeline = GraphicsPipelineBuilder::build(mDevice, mCache->handle(), desc, modules, &feedback.info);
+	}
+	mCache->recordFeedback(entry.name.c_str(), feedback);
+	if (rebuild)
+	{
+		entry.replacement = pipeline;
+		entry.replacementReady.store(true, std::memory_order_release);
+		return;
+	}
+	entry.pipeline = pipeline;
+	entry.state.store(State::Ready, std::memory_order_release);
+}
+
+void PipelineManager::workerLoop()
+{
+	KS_PROFILE_THREAD("pipeline worker");
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWorkAvailable.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+		if (mStopping)
+		{
+			return;
+		}
+		Job job = mJobs.front();
+		mJobs.pop_front();
+		mActiveJobs++;
+		lock.unlock();
+		compile(*job.entry, job.rebuild);
+		lock.lock();
+		mActiveJobs--;
+		if (mJobs.empty() && mActiveJobs == 0)
+		{
+			mWorkDone.notify_all();
+		}
+	}
+}
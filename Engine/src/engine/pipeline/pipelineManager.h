@@ -0,0 +1,106 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "pipelineBuilder.h"
+#include "../type.h"
+
+class PipelineCache;
+class ShaderModuleCache;
+
+using PipelineHandle = uint32_t;
+constexpr static PipelineHandle INVALID_PIPELINE_HANDLE = ~0u;
+
+//owns every pipeline of the engine. Requests are deduplicated by the hash of their full description
+//and compiled on a pool of worker threads, either in a blocking batch at load time or lazily on first use
+class PipelineManager
+{
+public:
+	void init(VkDevice device, PipelineCache* cache, ShaderModuleCache* shaderModules, uint32_t workerCount);
+	void destroy();
+	//returns the existing pipeline when an equal description was requested before, otherwise registers it
+	//without compiling. fallback is used by acquire() while this pipeline is still compiling
+	PipelineHandle request(const GraphicsPipelineBuilder& builder, const char* name, PipelineHandle fallback = INVALID_PIPELINE_HANDLE);
+	PipelineHandle request(const ComputePipelineBuilder& builder, const char* name, PipelineHandle fallback = INVALID_PIPELINE_HANDLE);
+	//compiles every registered pipeline concurrently and waits for them, including ones already compiling
+	void compilePending();
+	//never blocks: the first call starts a background compile, until it finishes the fallback's pipeline
+	//is returned when that one is ready, otherwise nullptr and the caller skips its draws
+	VkPipeline acquire(PipelineHandle handle);
+	//recompiles every ready pipeline using shaderName in the background, the old pipelines stay in use meanwhile
+	uint32_t rebuildUsing(const std::string& shaderName);
+	//swaps in finished rebuilds, call at a frame boundary. old pipelines go to retireQueue, which must outlive the frames using them
+	void swapRebuilt(DeletionQueue& retireQueue);
+	//no compile queued or running and no rebuild waiting to be swapped, nothing holds a shader module
+	bool idle();
+	bool isReady(PipelineHandle handle) const { return mEntries[handle].state.load(std::memory_order_acquire) == State::Ready; }
+	//only valid once the pipeline is ready
+	VkPipeline get(PipelineHandle handle) const { return mEntries[handle].pipeline; }
+	//workgroups a compute pipeline needs to cover extent, from the workgroup size it was specialized with.
+	//a compute fallback has to use the same workgroup size
+	VkExtent3D groupCount(PipelineHandle handle, VkExtent3D extent) const;
+	uint32_t pipelineCount() const { return static_cast<uint32_t>(mEntries.size()); }
+	uint32_t dedupCount() const { return mDedupCount; }
+private:
+	enum class State : uint32_t
+	{
+		Registered,
+		Queued,
+		Ready
+	};
+	struct Entry
+	{
+		std::string			 name;
+		uint64_t			 hash{ 0 };
+		bool				 isCompute{ false };
+		GraphicsPipelineDesc graphics;
+		ComputePipelineDesc	 compute;
+		PipelineHandle		 fallback{ INVALID_PIPELINE_HANDLE };
+		//written by the worker before state turns Ready
+		VkPipeline			 pipeline{ nullptr };
+		std::atomic<State>	 state{ State::Registered };
+		//hot reload: written by the worker before replacementReady turns true
+		VkPipeline			 replacement{ nullptr };
+		std::atomic<bool>	 replacementReady{ false };
+		bool				 rebuilding{ false };
+		//the shader changed again while a rebuild was running
+		bool				 rebuildAgain{ false };
+	};
+	struct Job
+	{
+		Entry* entry;
+		bool   rebuild;
+	};
+	PipelineHandle findOrAdd(const char* name, uint64_t hash, const GraphicsPipelineDesc* graphics, const ComputePipelineDesc* compute, PipelineHandle fallback);
+	//caller holds mMutex
+	void enqueue(PipelineHandle handle);
+	void compile(Entry& entry, bool rebuild);
+	bool usesShader(const Entry& entry, const std::string& shaderName) const;
+	void workerLoop();
+private:
+	VkDevice						   mDevice{ nullptr };
+	PipelineCache*					   mCache{ nullptr };
+	ShaderModuleCache*				   mShaderModules{ nullptr };
+	//deque so workers can hold entry pointers while new requests come in
+	std::deque<Entry>				   mEntries;
+	std::unordered_multimap<uint64_t, PipelineHandle> mLookup;
+	std::vector<PipelineHandle>		   mRegistered;
+	std::vector<PipelineHandle>		   mRebuilding;
+	uint32_t						   mDedupCount{ 0 };
+	uint32_t						   mFallbackCount{ 0 };
+	uint32_t						   mSkipCount{ 0 };
+
+	std::vector<std::thread>		   mWorkers;
+	std::mutex						   mMutex;
+	std::condition_variable			   mWorkAvailable;
+	std::condition_variable			   mWorkDone;
+	std::deque<Job>					   mJobs;
+	uint32_t						   mActiveJobs{ 0 };
+	bool							   mStopping{ false };
+};
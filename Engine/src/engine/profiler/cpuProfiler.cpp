@@ -0,0 +1,115 @@
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "cpuProfiler.h"
+#include "core.h"
+
+std::atomic<uint32_t> CpuProfiler::sFrameNumber{ 0 };
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex										   mutex;
+		//buffers outlive their threads so zones of finished workers can still be exported
+		std::vector<std::unique_ptr<CpuProfiler::ThreadBuffer>> buffers;
+		uint64_t										   startTick{ CpuProfiler::ticks() };
+		std::chrono::steady_clock::time_point			   startTime{ std::chrono::steady_clock::now() };
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::registerThread()
+{
+	Registry& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+	ThreadBuffer* buffer = reg.buffers.back().get();
+	buffer->threadIndex = static_cast<uint32_t>(reg.buffers.size() - 1);
+	snprintf(buffer->name, sizeof(buffer->name), "thread %u", buffer->threadIndex);
+	return buffer;
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = threadBuffer();
+	//the exporter reads the names under the registry lock
+	std::lock_guard<std::mutex> lock(registry().mutex);
+	strncpy(buffer->name, name, sizeof(buffer->name) - 1);
+}
+
+bool CpuProfiler::exportChromeTrace(const char* filePath)
+{
+	Registry& reg = registry();
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		KS_CORE_ERROR("CpuProfiler: failed to open {}", filePath);
+		return false;
+	}
+
+	//calibrate ticks against the steady clock over the whole run
+	uint64_t endTick = ticks();
+	double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - reg.startTime).count();
+	double usPerTick = elapsedUs > 0.0 && endTick > reg.startTick ? elapsedUs / static_cast<double>(endTick - reg.startTick) : 1.0;
+
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	file << std::fixed;
+	file.precision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	size_t eventCount = 0;
+	std::vector<ZoneEvent> events;
+	for (auto& buffer : reg.buffers)
+	{
+		file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadIndex << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+		first = false;
+
+		//the owner keeps writing, a slot is only kept if its sequence still names the same complete zone
+		//before and after the copy
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t begin = head > ThreadBuffer::CAPACITY ? head - ThreadBuffer::CAPACITY : 0;
+		events.clear();
+		for (uint64_t index = begin; index < head; index++)
+		{
+			const ZoneSlot& slot = buffer->slots[index & (ThreadBuffer::CAPACITY - 1)];
+			uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence != index * 2 + 2)
+			{
+				continue;
+			}
+			ZoneEvent event{ slot.name.load(std::memory_order_relaxed), slot.beginTick.load(std::memory_order_relaxed),
+				slot.endTick.load(std::memory_order_relaxed), slot.frameNumber.load(std::memory_order_relaxed) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+			{
+				events.push_back(event);
+			}
+		}
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			const ZoneEvent& event = events[i];
+			if (event.beginTick < reg.startTick)
+			{
+				continue;
+			}
+			double ts = static_cast<double>(event.beginTick - reg.startTick) * usPerTick;
+			double dur = static_cast<double>(event.endTick - event.beginTick) * usPerTick;
+			file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadIndex
+				<< ",\"ts\":" << ts << ",\"dur\":" << dur << ",\"args\":{\"frame\":" << event.frameNumber << "}}";
+			eventCount++;
+		}
+	}
+	file << "\n]}\n";
+	KS_CORE_INFO("CpuProfiler: wrote {} zones to {}", eventCount, filePath);
+	return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+//set KS_PROFILING to 0 to compile every zone out
+#ifndef KS_PROFILING
+#define KS_PROFILING 1
+#endif
+
+//each thread writes its zones into its own ring without locking, the only shared state touched per
+//zone is a relaxed load of the frame number. the exporter reads the rings while they are written and
+//drops the slots whose sequence shows they were torn or overwritten
+class CpuProfiler
+{
+public:
+	struct ZoneEvent
+	{
+		const char* name;
+		uint64_t	beginTick;
+		uint64_t	endTick;
+		uint32_t	frameNumber;
+	};
+
+	//seqlock of one ring entry: sequence is odd while the owner writes it and 2 * (index + 1) once
+	//the zone with that index is complete
+	struct ZoneSlot
+	{
+		std::atomic<uint64_t>	 sequence{ 0 };
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t>	 beginTick{ 0 };
+		std::atomic<uint64_t>	 endTick{ 0 };
+		std::atomic<uint32_t>	 frameNumber{ 0 };
+	};
+
+	struct ThreadBuffer
+	{
+		constexpr static uint64_t CAPACITY = 1 << 16;
+		ZoneSlot			  slots[CAPACITY];
+		//only stored by the owning thread
+		std::atomic<uint64_t> head{ 0 };
+		uint32_t			  threadIndex{ 0 };
+		char				  name[32]{};
+	};
+public:
+	static inline uint64_t ticks()
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+	static inline void record(const char* name, uint64_t beginTick, uint64_t endTick)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		uint64_t head = buffer->head.load(std::memory_order_relaxed);
+		ZoneSlot& slot = buffer->slots[head & (ThreadBuffer::CAPACITY - 1)];
+		slot.sequence.store(head * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.beginTick.store(beginTick, std::memory_order_relaxed);
+		slot.endTick.store(endTick, std::memory_order_relaxed);
+		slot.frameNumber.store(sFrameNumber.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		slot.sequence.store(head * 2 + 2, std::memory_order_release);
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+	static void setFrame(uint32_t frameNumber) { sFrameNumber.store(frameNumber, std::memory_order_relaxed); }
+	static void setThreadName(const char* name);
+	static bool exportChromeTrace(const char* filePath);
+private:
+	static inline ThreadBuffer* threadBuffer()
+	{
+		static thread_local ThreadBuffer* buffer = registerThread();
+		return buffer;
+	}
+	static ThreadBuffer* registerThread();
+private:
+	static std::atomic<uint32_t> sFrameNumber;
+};
+
+struct CpuProfileZone
+{
+	CpuProfileZone(const char* name) :name(name), beginTick(CpuProfiler::ticks()) {}
+	~CpuProfileZone() { CpuProfiler::record(name, beginTick, CpuProfiler::ticks()); }
+	const char* name;
+	uint64_t	beginTick;
+};
+
+#define KS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define KS_PROFILE_CONCAT(a, b) KS_PROFILE_CONCAT_IMPL(a, b)
+#if KS_PROFILING
+#define KS_PROFILE_ZONE(name) ::CpuProfileZone KS_PROFILE_CONCAT(ksProfileZone, __LINE__)(name)
+#define KS_PROFILE_FUNCTION() KS_PROFILE_ZONE(__FUNCTION__)
+#define KS_PROFILE_FRAME(frameNumber) ::CpuProfiler::setFrame(frameNumber)
+#define KS_PROFILE_THREAD(name) ::CpuProfiler::setThreadName(name)
+#else
+#define KS_PROFILE_ZONE(name)
+#define KS_PROFILE_FUNCTION()
+#define KS_PROFILE_FRAME(frameNumber)
+#define KS_PROFILE_THREAD(name)
+#endif
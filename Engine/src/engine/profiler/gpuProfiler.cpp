@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <fstream>
+#include "gpuProfiler.h"
+#include "core.h"
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots, uint32_t maxScopesPerFrame)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+	uint32_t validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+	if (validBits == 0 || properties.limits.timestampPeriod == 0.0f)
+	{
+		KS_CORE_WARN("GpuProfiler: timestamps are not supported on this queue, gpu profiling disabled");
+		return;
+	}
+	mTimestampPeriod = properties.limits.timestampPeriod;
+	mTimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	mMaxScopes = maxScopesPerFrame;
+	mFrames.resize(frameSlots);
+	for (auto& frame : mFrames)
+	{
+		frame.names.resize(mMaxScopes);
+		frame.depths.resize(mMaxScopes);
+	}
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.pNext = nullptr;
+	poolInfo.flags = 0;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = frameSlots * mMaxScopes * 2;
+	VK_CHECK(vkCreateQueryPool(device, &poolInfo, nullptr, &mQueryPool));
+}
+
+void GpuProfiler::destroy(VkDevice device)
+{
+	if (mQueryPool)
+	{
+		vkDestroyQueryPool(device, mQueryPool, nullptr);
+		mQueryPool = VK_NULL_HANDLE;
+	}
+}
+
+void GpuProfiler::beginFrame(VkDevice device, VkCommandBuffer cmd, uint32_t slot, uint64_t frameNumber)
+{
+	if (!isSupported())
+	{
+		return;
+	}
+	collect(device, slot);
+	mCurrentSlot = slot;
+	mCurrentDepth = 0;
+	FrameQueries& frame = mFrames[slot];
+	frame.scopeCount = 0;
+	frame.frameNumber = frameNumber;
+	frame.pending = true;
+	vkCmdResetQueryPool(cmd, mQueryPool, slot * mMaxScopes * 2, mMaxScopes * 2);
+}
+
+void GpuProfiler::collectAll(VkDevice device)
+{
+	for (uint32_t i = 0; i < mFrames.size(); i++)
+	{
+		collect(device, i);
+	}
+}
+
+void GpuProfiler::collect(VkDevice device, uint32_t slot)
+{
+	FrameQueries& frame = mFrames[slot];
+	if (!frame.pending || frame.scopeCount == 0)
+	{
+		frame.pending = false;
+		return;
+	}
+	std::vector<uint64_t> ticks(frame.scopeCount * 2);
+	//the slot's submission has already been waited on, so no WAIT flag is needed
+	VkResult res = vkGetQueryPoolResults(device, mQueryPool, slot * mMaxScopes * 2, frame.scopeCount * 2,
+		ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	frame.pending = false;
+	if (res != VK_SUCCESS)
+	{
+		return;
+	}
+	for (uint32_t i = 0; i < frame.scopeCount; i++)
+	{
+		uint64_t beginTick = ticks[i * 2] & mTimestampMask;
+		uint64_t endTick = ticks[i * 2 + 1] & mTimestampMask;
+		if (endTick < beginTick)
+		{
+			continue;
+		}
+		double ms = static_cast<double>(endTick - beginTick) * mTimestampPeriod / 1e6;
+		auto& history = mHistory[frame.names[i]];
+		if (history.empty())
+		{
+			mScopeOrder.push_back(frame.names[i]);
+		}
+		history.push_back(ms);
+		if (history.size() > HISTORY_SIZE)
+		{
+			history.pop_front();
+		}
+		mTraceEvents.push_back(TraceEvent{ frame.names[i], frame.frameNumber, frame.depths[i], beginTick, endTick });
+		if (mTraceEvents.size() > MAX_TRACE_EVENTS)
+		{
+			mTraceEvents.pop_front();
+		}
+	}
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char* name)
+{
+	if (!isSupported())
+	{
+		return UINT32_MAX;
+	}
+	FrameQueries& frame = mFrames[mCurrentSlot];
+	if (frame.scopeCount >= mMaxScopes)
+	{
+		KS_CORE_WARN("GpuProfiler: more than {} scopes in one frame, '{}' is not recorded", mMaxScopes, name);
+		return UINT32_MAX;
+	}
+	uint32_t scope = frame.scopeCount++;
+	frame.names[scope] = name;
+	frame.depths[scope] = mCurrentDepth++;
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, mQueryPool, (mCurrentSlot * mMaxScopes + scope) * 2);
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope)
+{
+	if (scope == UINT32_MAX)
+	{
+		return;
+	}
+	mCurrentDepth--;
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, mQueryPool, (mCurrentSlot * mMaxScopes + scope) * 2 + 1);
+}
+
+GpuProfiler::ScopeStatistics GpuProfiler::getStatistics(const std::string& name) const
+{
+	ScopeStatistics statistics;
+	auto iter = mHistory.find(name);
+	if (iter == mHistory.end() || iter->second.empty())
+	{
+		return statistics;
+	}
+	std::vector<double> samples(iter->second.begin(), iter->second.end());
+	double sum = 0.0;
+	for (double sample : samples)
+	{
+		sum += sample;
+	}
+	statistics.sampleCount = static_cast<uint32_t>(samples.size());
+	statistics.avgMs = sum / samples.size();
+	statistics.minMs = *std::min_element(samples.begin(), samples.end());
+	size_t p99Index = std::min(samples.size() - 1, static_cast<size_t>(samples.size() * 0.99));
+	std::nth_element(samples.begin(), samples.begin() + p99Index, samples.end());
+	statistics.p99Ms = samples[p99Index];
+	return statistics;
+}
+
+void GpuProfiler::logStatistics() const
+{
+	for (auto& name : mScopeOrder)
+	{
+		ScopeStatistics statistics = getStatistics(name);
+		KS_CORE_INFO("GPU {:<12} min {:.3f} ms  avg {:.3f} ms  p99 {:.3f} ms  ({} samples)", name, statistics.minMs, statistics.avgMs, statistics.p99Ms, statistics.sampleCount);
+	}
+}
+
+bool GpuProfiler::exportChromeTrace(const char* filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		KS_CORE_ERROR("GpuProfiler: failed to open {}", filePath);
+		return false;
+	}
+	uint64_t baseTick = UINT64_MAX;
+	for (auto& event : mTraceEvents)
+	{
+		baseTick = std::min(baseTick, event.beginTick);
+	}
+	file << std::fixed;
+	file.precision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+	for (auto& event : mTraceEvents)
+	{
+		double ts = static_cast<double>(event.beginTick - baseTick) * mTimestampPeriod / 1e3;
+		double dur = static_cast<double>(event.endTick - event.beginTick) * mTimestampPeriod / 1e3;
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+			<< ",\"ts\":" << ts << ",\"dur\":" << dur << ",\"args\":{\"frame\":" << event.frameNumber << ",\"depth\":" << event.depth << "}}";
+	}
+	file << "\n]}\n";
+	KS_CORE_INFO("GpuProfiler: wrote {} events to {}", mTraceEvents.size(), filePath);
+	return true;
+}
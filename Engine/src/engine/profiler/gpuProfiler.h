@@ -0,0 +1,77 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+//timestamp queries per frame slot, results of a slot are read back when the slot is reused
+//so the cpu never waits on a query
+class GpuProfiler
+{
+public:
+	struct ScopeStatistics
+	{
+		double	 minMs{ 0.0 };
+		double	 avgMs{ 0.0 };
+		double	 p99Ms{ 0.0 };
+		uint32_t sampleCount{ 0 };
+	};
+public:
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots, uint32_t maxScopesPerFrame = 32);
+	void destroy(VkDevice device);
+	//must be recorded first in the frame's command buffer, outside of any rendering
+	void beginFrame(VkDevice device, VkCommandBuffer cmd, uint32_t slot, uint64_t frameNumber);
+	//read back every slot that still holds results, the caller guarantees the gpu is idle
+	void collectAll(VkDevice device);
+	uint32_t beginScope(VkCommandBuffer cmd, const char* name);
+	void endScope(VkCommandBuffer cmd, uint32_t scope);
+	ScopeStatistics getStatistics(const std::string& name) const;
+	void logStatistics() const;
+	bool exportChromeTrace(const char* filePath) const;
+	bool isSupported() const { return mQueryPool != VK_NULL_HANDLE; }
+private:
+	struct FrameQueries
+	{
+		std::vector<std::string> names;
+		std::vector<uint32_t>	 depths;
+		uint32_t				 scopeCount{ 0 };
+		uint64_t				 frameNumber{ 0 };
+		bool					 pending{ false };
+	};
+	struct TraceEvent
+	{
+		std::string name;
+		uint64_t	frameNumber;
+		uint32_t	depth;
+		uint64_t	beginTick;
+		uint64_t	endTick;
+	};
+	void collect(VkDevice device, uint32_t slot);
+private:
+	VkQueryPool					 mQueryPool{ VK_NULL_HANDLE };
+	float						 mTimestampPeriod{ 1.0f };
+	uint64_t					 mTimestampMask{ ~0ull };
+	uint32_t					 mMaxScopes{ 0 };
+	uint32_t					 mCurrentSlot{ 0 };
+	uint32_t					 mCurrentDepth{ 0 };
+	std::vector<FrameQueries>	 mFrames;
+	//rolling history of scope durations in ms
+	std::unordered_map<std::string, std::deque<double>> mHistory;
+	std::vector<std::string>	 mScopeOrder;
+	std::deque<TraceEvent>		 mTraceEvents;
+	constexpr static size_t		 HISTORY_SIZE = 256;
+	constexpr static size_t		 MAX_TRACE_EVENTS = 64 * 1024;
+};
+
+struct GpuProfileScope
+{
+	GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name)
+		:profiler(profiler), cmd(cmd), scope(profiler.beginScope(cmd, name)) {}
+	~GpuProfileScope() { profiler.endScope(cmd, scope); }
+	GpuProfiler&	profiler;
+	VkCommandBuffer cmd;
+	uint32_t		scope;
+};
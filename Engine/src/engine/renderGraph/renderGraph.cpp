@@ -0,0 +1,634 @@
+#include <algorithm>
+#include "renderGraph.h"
+#include "core.h"
+#include "../vkInitializer.h"
+#include "../profiler/gpuProfiler.h"
+
+namespace
+{
+	using UsageInfo = RenderGraph::UsageInfo;
+
+	UsageInfo getUsageInfo(RGUsage usage)
+	{
+		switch (usage)
+		{
+		case RGUsage::ComputeStorageRead:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::ComputeStorageWrite:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::ComputeStorageReadWrite:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::VertexStorageRead:
+			return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::MeshStorageRead:
+			return { VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::IndirectRead:
+			return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+		case RGUsage::IndexRead:
+			return { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+		case RGUsage::ComputeSampled:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		case RGUsage::ComputeSampledGeneral:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case RGUsage::FragmentSampled:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		case RGUsage::ColorAttachment:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		case RGUsage::DepthAttachment:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL };
+		case RGUsage::DepthRead:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL };
+		case RGUsage::TransferSrc:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+		case RGUsage::TransferDst:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+		case RGUsage::Present:
+			return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+		}
+		return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	}
+
+	VkImageUsageFlags getImageUsage(RGUsage usage)
+	{
+		switch (usage)
+		{
+		case RGUsage::ComputeStorageRead:
+		case RGUsage::ComputeStorageWrite:
+		case RGUsage::ComputeStorageReadWrite:
+		case RGUsage::VertexStorageRead:
+		case RGUsage::MeshStorageRead:
+			return VK_IMAGE_USAGE_STORAGE_BIT;
+		case RGUsage::ComputeSampled:
+		case RGUsage::ComputeSampledGeneral:
+		case RGUsage::FragmentSampled:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case RGUsage::ColorAttachment:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case RGUsage::DepthAttachment:
+		case RGUsage::DepthRead:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case RGUsage::TransferSrc:
+			return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case RGUsage::TransferDst:
+			return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		case RGUsage::Present:
+		case RGUsage::IndirectRead:
+		case RGUsage::IndexRead:
+			return 0;
+		}
+		return 0;
+	}
+
+	constexpr VkAccessFlags2 WRITE_ACCESS_MASK = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+	//advances state by one access, returns whether it needs a barrier and from which stages/accesses
+	bool trackAccess(RenderGraph::ResourceState& state, const UsageInfo& info, bool write, bool layoutChange, VkPipelineStageFlags2& srcStage, VkAccessFlags2& srcAccess)
+	{
+		srcStage = VK_PIPELINE_STAGE_2_NONE;
+		srcAccess = VK_ACCESS_2_NONE;
+		if (write || layoutChange)
+		{
+			//write after write/read: wait for every earlier access, flush earlier writes
+			srcStage = state.writeStages | state.readStages;
+			srcAccess = state.writeAccess;
+			state.writeStages = write ? info.stage : srcStage | info.stage;
+			state.writeAccess = write ? (info.access & WRITE_ACCESS_MASK) : VK_ACCESS_2_NONE;
+			state.readStages = write ? VK_PIPELINE_STAGE_2_NONE : info.stage;
+			state.visibleStages = info.stage;
+			state.visibleAccess = info.access;
+			return layoutChange || srcStage != VK_PIPELINE_STAGE_2_NONE;
+		}
+		//read after write: only if the write is not yet visible to this stage/access
+		bool needBarrier = false;
+		bool stagesCovered = (state.visibleStages & info.stage) == info.stage;
+		bool accessCovered = (state.visibleAccess & info.access) == info.access;
+		if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && (!stagesCovered || !accessCovered))
+		{
+			needBarrier = true;
+			srcStage = state.writeStages;
+			srcAccess = state.writeAccess;
+			state.visibleStages |= info.stage;
+			state.visibleAccess |= info.access;
+		}
+		state.readStages |= info.stage;
+		return needBarrier;
+	}
+}
+
+RenderGraph::Pass& RenderGraph::Pass::read(RGResource resource, RGUsage usage)
+{
+	accesses.push_back(Access{ resource, usage, true, false });
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(RGResource resource, RGUsage usage)
+{
+	accesses.push_back(Access{ resource, usage, false, true });
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::modify(RGResource resource, RGUsage usage)
+{
+	accesses.push_back(Access{ resource, usage, true, true });
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::sideEffect()
+{
+	hasSideEffect = true;
+	return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::async()
+{
+	queue = RGQueue::Compute;
+	return *this;
+}
+
+void RenderGraph::init(VkDevice device, VmaAllocator allocator, uint32_t graphicsFamily, uint32_t computeFamily)
+{
+	mTransientPool.init(device, allocator);
+	mGraphicsFamily = graphicsFamily;
+	mComputeFamily = computeFamily;
+}
+
+void RenderGraph::destroy()
+{
+	mTransientPool.destroy();
+	mImageStates.clear();
+	mBufferStates.clear();
+}
+
+void RenderGraph::reset(uint64_t timelineValue)
+{
+	mResources.clear();
+	mPasses.clear();
+	mBarrierCount = 0;
+	mAsyncPassCount = 0;
+	mAsyncWaitStages = VK_PIPELINE_STAGE_2_NONE;
+	mTimelineValue = timelineValue;
+	mAsyncDependencyValue = 0;
+	mAsyncStages = VK_PIPELINE_STAGE_2_NONE;
+}
+
+RGResource RenderGraph::importImage(const char* name, VkImage image, VkImageAspectFlags aspect, bool discardContents)
+{
+	ResourceState state;
+	auto iter = mImageStates.find(image);
+	if (iter != mImageStates.end())
+	{
+		state = iter->second;
+	}
+	if (discardContents)
+	{
+		state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+	RGResource resource = importImage(name, image, aspect, state);
+	mResources[resource].tracked = true;
+	return resource;
+}
+
+RGResource RenderGraph::importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const ResourceState& initialState)
+{
+	Resource resource;
+	resource.name = name;
+	resource.image = image;
+	resource.aspect = aspect;
+	resource.state = initialState;
+	mResources.push_back(resource);
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+RGResource RenderGraph::importBuffer(const char* name, VkBuffer buffer)
+{
+	Resource resource;
+	resource.name = name;
+	resource.buffer = buffer;
+	resource.aspect = 0;
+	auto iter = mBufferStates.find(buffer);
+	if (iter != mBufferStates.end())
+	{
+		resource.state = iter->second;
+	}
+	resource.tracked = true;
+	mResources.push_back(resource);
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+RGResource RenderGraph::createImage(const char* name, const RGImageDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.aspect = desc.aspect;
+	resource.transient = true;
+	resource.desc = desc;
+	mResources.push_back(resource);
+	return static_cast<RGResource>(mResources.size() - 1);
+}
+
+void RenderGraph::markOutput(RGResource resource)
+{
+	mResources[resource].output = true;
+}
+
+void RenderGraph::setFinalUsage(RGResource resource, RGUsage usage)
+{
+	mResources[resource].output = true;
+	mResources[resource].hasFinalUsage = true;
+	mResources[resource].finalUsage = usage;
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const char* name, std::function<void(VkCommandBuffer cmd)>&& execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	mPasses.push_back(std::move(pass));
+	return mPasses.back();
+}
+
+void RenderGraph::compile(VkCommandBuffer computeCmd, DeletionQueue& retireQueue)
+{
+	//without a separate family there is nothing to overlap with, async passes are recorded inline
+	mComputeCmd = mComputeFamily != mGraphicsFamily ? computeCmd : nullptr;
+	//walk backwards from the outputs, a pass survives if it writes something a later surviving pass or output needs
+	std::vector<bool> needed(mResources.size(), false);
+	for (size_t i = 0; i < mResources.size(); i++)
+	{
+		needed[i] = mResources[i].output;
+	}
+	for (auto pass = mPasses.rbegin(); pass != mPasses.rend(); pass++)
+	{
+		bool keep = pass->hasSideEffect;
+		for (auto& access : pass->accesses)
+		{
+			if (access.write && needed[access.resource])
+			{
+				keep = true;
+			}
+		}
+		pass->culled = !keep;
+		if (!keep)
+		{
+			KS_CORE_TRACE("RenderGraph: culled pass '{}'", pass->name);
+			continue;
+		}
+		for (auto& access : pass->accesses)
+		{
+			if (access.write && !access.read)
+			{
+				//fully overwritten, earlier contents are not needed by this pass
+				needed[access.resource] = false;
+			}
+		}
+		for (auto& access : pass->accesses)
+		{
+			if (access.read)
+			{
+				needed[access.resource] = true;
+			}
+		}
+	}
+	assignQueues();
+	allocateTransients(retireQueue);
+}
+
+void RenderGraph::assignQueues()
+{
+	//the only cross queue sync point of a frame is graphics waiting on compute, so an async pass
+	//has to stay clear of anything the graphics queue touched earlier in the frame
+	std::vector<bool> touchedByGraphics(mResources.size(), false);
+	std::vector<bool> producedByCompute(mResources.size(), false);
+	for (auto& pass : mPasses)
+	{
+		if (pass.culled)
+		{
+			continue;
+		}
+		if (pass.queue == RGQueue::Compute)
+		{
+			bool canRunAsync = mComputeCmd != nullptr;
+			for (auto& access : pass.accesses)
+			{
+				const Resource& resource = mResources[access.resource];
+				//transient memory is synchronized on the graphics queue only, buffers are never transferred
+				bool sharedMemory = resource.transient || resource.buffer;
+				//old contents owned by the graphics queue would need a transfer from the previous frame
+				bool needsOldContents = access.read ? !producedByCompute[access.resource] : resource.state.layout != VK_IMAGE_LAYOUT_UNDEFINED && resource.state.queue != RGQueue::Compute;
+				if (sharedMemory || needsOldContents || touchedByGraphics[access.resource])
+				{
+					canRunAsync = false;
+				}
+			}
+			if (!canRunAsync)
+			{
+				if (mComputeCmd)
+				{
+					KS_CORE_TRACE("RenderGraph: pass '{}' runs on the graphics queue", pass.name);
+				}
+				pass.queue = RGQueue::Graphics;
+			}
+		}
+		for (auto& access : pass.accesses)
+		{
+			if (pass.queue == RGQueue::Compute)
+			{
+				producedByCompute[access.resource] = producedByCompute[access.resource] || access.write;
+			}
+			else
+			{
+				touchedByGraphics[access.resource] = true;
+			}
+		}
+		if (pass.queue == RGQueue::Compute)
+		{
+			mAsyncPassCount++;
+		}
+	}
+}
+
+void RenderGraph::allocateTransients(DeletionQueue& retireQueue)
+{
+	//lifetime of a transient is the span between the first and last surviving pass touching it
+	mTransientRequests.clear();
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); passIndex++)
+	{
+		if (mPasses[passIndex].culled)
+		{
+			continue;
+		}
+		for (auto& access : mPasses[passIndex].accesses)
+		{
+			Resource& resource = mResources[access.resource];
+			if (!resource.transient)
+			{
+				continue;
+			}
+			if (resource.firstUse)
+			{
+				resource.firstUse = false;
+				resource.transientIndex = static_cast<uint32_t>(mTransientRequests.size());
+				mTransientRequests.push_back(TransientPool::Request{ resource.desc, 0, passIndex, passIndex });
+			}
+			TransientPool::Request& request = mTransientRequests[resource.transientIndex];
+			request.usage |= getImageUsage(access.usage);
+			request.lastPass = passIndex;
+		}
+	}
+	mTransientPool.allocate(mTransientRequests, mTransientPlacements, retireQueue);
+	for (auto& resource : mResources)
+	{
+		if (resource.transient && !resource.firstUse)
+		{
+			resource.image = mTransientPlacements[resource.transientIndex].image;
+			resource.imageView = mTransientPlacements[resource.transientIndex].imageView;
+			//reused as "not yet touched this frame" by execute()
+			resource.firstUse = true;
+		}
+	}
+}
+
+RenderGraph::ResourceState RenderGraph::transientInitialState(const Resource& resource) const
+{
+	//contents are undefined, but the memory may still be in use by whatever aliased it before:
+	//the previous frame's transients and this frame's earlier transients overlapping the same range
+	ResourceState state = mTransientBlockState;
+	state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	const TransientPool::Placement& placement = mTransientPlacements[resource.transientIndex];
+	for (auto& other : mResources)
+	{
+		if (!other.transient || other.firstUse || &other == &resource)
+		{
+			continue;
+		}
+		const TransientPool::Placement& otherPlacement = mTransientPlacements[other.transientIndex];
+		if (placement.offset < otherPlacement.offset + otherPlacement.size && otherPlacement.offset < placement.offset + placement.size)
+		{
+			state.writeStages |= other.state.writeStages;
+			state.writeAccess |= other.state.writeAccess;
+			state.readStages |= other.state.readStages;
+		}
+	}
+	state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+	state.visibleAccess = VK_ACCESS_2_NONE;
+	return state;
+}
+
+void RenderGraph::addBarrier(Resource& resource, const UsageInfo& info, bool write, RGQueue queue, std::vector<VkImageMemoryBarrier2>& barriers)
+{
+	ResourceState& state = resource.state;
+	if (queue == RGQueue::Compute)
+	{
+		//the compute submission only has to wait for the graphics work that last used what it touches
+		mAsyncDependencyValue = std::max(mAsyncDependencyValue, state.graphicsValue);
+		mAsyncStages |= info.stage;
+	}
+	if (state.queue != queue)
+	{
+		if (queue == RGQueue::Graphics)
+		{
+			transferToGraphics(resource, info, write, barriers);
+			return;
+		}
+		//contents are discarded (see assignQueues), earlier graphics work is ordered by the frame semaphore
+		state.writeStages = VK_PIPELINE_STAGE_2_NONE;
+		state.writeAccess = VK_ACCESS_2_NONE;
+		state.readStages = VK_PIPELINE_STAGE_2_NONE;
+		state.queue = queue;
+	}
+	if (queue == RGQueue::Graphics)
+	{
+		state.graphicsValue = mTimelineValue;
+	}
+	bool layoutChange = state.layout != info.layout;
+	VkPipelineStageFlags2 srcStage;
+	VkAccessFlags2 srcAccess;
+	bool needBarrier = trackAccess(state, info, write, layoutChange, srcStage, srcAccess);
+	if (!needBarrier)
+	{
+		return;
+	}
+	VkImageMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	barrier.pNext = nullptr;
+	barrier.srcStageMask = srcStage;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = info.stage;
+	barrier.dstAccessMask = info.access;
+	barrier.oldLayout = state.layout;
+	barrier.newLayout = info.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = resource.image;
+	barrier.subresourceRange = VkInitializer::imageSubresourceRange(resource.aspect);
+	barriers.push_back(barrier);
+	state.layout = info.layout;
+}
+
+void RenderGraph::addBufferBarrier(Resource& resource, const UsageInfo& info, bool write)
+{
+	VkPipelineStageFlags2 srcStage;
+	VkAccessFlags2 srcAccess;
+	if (!trackAccess(resource.state, info, write, false, srcStage, srcAccess))
+	{
+		return;
+	}
+	VkBufferMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+	barrier.pNext = nullptr;
+	barrier.srcStageMask = srcStage;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = info.stage;
+	barrier.dstAccessMask = info.access;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = resource.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	mBufferBarriers.push_back(barrier);
+}
+
+void RenderGraph::transferToGraphics(Resource& resource, const UsageInfo& info, bool write, std::vector<VkImageMemoryBarrier2>& barriers)
+{
+	ResourceState& state = resource.state;
+	VkImageMemoryBarrier2 release{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	release.pNext = nullptr;
+	release.srcStageMask = state.writeStages | state.readStages;
+	release.srcAccessMask = state.writeAccess;
+	release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+	release.dstAccessMask = VK_ACCESS_2_NONE;
+	release.oldLayout = state.layout;
+	release.newLayout = info.layout;
+	release.srcQueueFamilyIndex = mComputeFamily;
+	release.dstQueueFamilyIndex = mGraphicsFamily;
+	release.image = resource.image;
+	release.subresourceRange = VkInitializer::imageSubresourceRange(resource.aspect);
+	//later async passes never touch this resource again, so releasing right away is safe
+	mReleaseBarriers.push_back(release);
+	flushBarriers(mComputeCmd, mReleaseBarriers);
+
+	VkImageMemoryBarrier2 acquire = release;
+	acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	acquire.srcAccessMask = VK_ACCESS_2_NONE;
+	acquire.dstStageMask = info.stage;
+	acquire.dstAccessMask = info.access;
+	barriers.push_back(acquire);
+	mAsyncWaitStages |= info.stage;
+
+	state.layout = info.layout;
+	state.writeStages = info.stage;
+	state.writeAccess = write ? (info.access & WRITE_ACCESS_MASK) : VK_ACCESS_2_NONE;
+	state.readStages = write ? VK_PIPELINE_STAGE_2_NONE : info.stage;
+	state.visibleStages = info.stage;
+	state.visibleAccess = info.access;
+	state.queue = RGQueue::Graphics;
+	state.graphicsValue = mTimelineValue;
+}
+
+void RenderGraph::flushBarriers(VkCommandBuffer cmd, std::vector<VkImageMemoryBarrier2>& barriers, std::vector<VkBufferMemoryBarrier2>* bufferBarriers)
+{
+	if (barriers.empty() && (!bufferBarriers || bufferBarriers->empty()))
+	{
+		return;
+	}
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.pNext = nullptr;
+	depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+	depInfo.pImageMemoryBarriers = barriers.data();
+	if (bufferBarriers)
+	{
+		depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers->size());
+		depInfo.pBufferMemoryBarriers = bufferBarriers->data();
+	}
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+	mBarrierCount++;
+	barriers.clear();
+	if (bufferBarriers)
+	{
+		bufferBarriers->clear();
+	}
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, GpuProfiler* profiler)
+{
+	for (auto& pass : mPasses)
+	{
+		if (pass.culled)
+		{
+			continue;
+		}
+		VkCommandBuffer passCmd = pass.queue == RGQueue::Compute ? mComputeCmd : cmd;
+		for (auto& access : pass.accesses)
+		{
+			Resource& resource = mResources[access.resource];
+			if (resource.transient && resource.firstUse)
+			{
+				resource.state = transientInitialState(resource);
+				resource.firstUse = false;
+			}
+			if (resource.buffer)
+			{
+				addBufferBarrier(resource, getUsageInfo(access.usage), access.write);
+				continue;
+			}
+			addBarrier(resource, getUsageInfo(access.usage), access.write, pass.queue, mBarriers);
+		}
+		flushBarriers(passCmd, mBarriers, &mBufferBarriers);
+		//timestamps are reset on the graphics queue, async passes are not timed
+		if (profiler && pass.queue == RGQueue::Graphics)
+		{
+			GpuProfileScope scope(*profiler, passCmd, pass.name.c_str());
+			pass.execute(passCmd);
+		}
+		else
+		{
+			pass.execute(passCmd);
+		}
+	}
+	for (auto& resource : mResources)
+	{
+		if (resource.hasFinalUsage)
+		{
+			addBarrier(resource, getUsageInfo(resource.finalUsage), false, RGQueue::Graphics, mBarriers);
+		}
+		else if (resource.state.queue == RGQueue::Compute && !resource.transient)
+		{
+			//hand everything back so the next frame starts with the graphics queue owning it
+			UsageInfo keep{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT, resource.state.layout };
+			transferToGraphics(resource, keep, false, mBarriers);
+		}
+	}
+	flushBarriers(cmd, mBarriers);
+	ResourceState blockState;
+	for (auto& resource : mResources)
+	{
+		if (resource.tracked)
+		{
+			if (resource.buffer)
+			{
+				mBufferStates[resource.buffer] = resource.state;
+			}
+			else
+			{
+				mImageStates[resource.image] = resource.state;
+			}
+		}
+		if (resource.transient && !resource.firstUse)
+		{
+			blockState.writeStages |= resource.state.writeStages;
+			blockState.writeAccess |= resource.state.writeAccess;
+			blockState.readStages |= resource.state.readStages;
+		}
+	}
+	mTransientBlockState = blockState;
+}
+
+void RenderGraph::forgetImage(VkImage image)
+{
+	mImageStates.erase(image);
+}
+
+void RenderGraph::forgetBuffer(VkBuffer buffer)
+{
+	mBufferStates.erase(buffer);
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "transientPool.h"
+
+class GpuProfiler;
+
+//how a pass touches a resource, each usage maps to exact stage/access/layout
+enum class RGUsage
+{
+	ComputeStorageRead,
+	ComputeStorageWrite,
+	//atomics
+	ComputeStorageReadWrite,
+	VertexStorageRead,
+	//task and mesh shaders, only valid on devices with VK_EXT_mesh_shader
+	MeshStorageRead,
+	IndirectRead,
+	IndexRead,
+	ComputeSampled,
+	//sampled while other mips of the same image are storage written
+	ComputeSampledGeneral,
+	FragmentSampled,
+	ColorAttachment,
+	DepthAttachment,
+	DepthRead,
+	TransferSrc,
+	TransferDst,
+	Present,
+};
+
+enum class RGQueue
+{
+	Graphics,
+	Compute,
+};
+
+using RGResource = uint32_t;
+
+//per frame graph: passes declare their reads and writes, compile() culls passes that contribute
+//to no output and execute() records each pass behind one batched barrier with precise masks.
+//transient images only live between their first and last pass and share memory through TransientPool.
+//buffers are imported only and stay on the graphics queue
+class RenderGraph
+{
+public:
+	struct ResourceState
+	{
+		VkImageLayout		  layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		//last writer and the readers since then, a new write has to wait for all of them
+		VkPipelineStageFlags2 writeStages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2		  writeAccess{ VK_ACCESS_2_NONE };
+		VkPipelineStageFlags2 readStages{ VK_PIPELINE_STAGE_2_NONE };
+		//stages/accesses the last write has already been made visible to
+		VkPipelineStageFlags2 visibleStages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2		  visibleAccess{ VK_ACCESS_2_NONE };
+		RGQueue				  queue{ RGQueue::Graphics };
+		//frame timeline value of the last graphics submission touching it, 0 if none did
+		uint64_t			  graphicsValue{ 0 };
+	};
+
+	//exact stage/access/layout an RGUsage stands for
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 stage;
+		VkAccessFlags2		  access;
+		VkImageLayout		  layout;
+	};
+
+	struct Pass
+	{
+		struct Access
+		{
+			RGResource resource;
+			RGUsage	   usage;
+			bool	   read;
+			bool	   write;
+		};
+		Pass& read(RGResource resource, RGUsage usage);
+		Pass& write(RGResource resource, RGUsage usage);
+		//read-modify-write, e.g. a color attachment with LOAD_OP_LOAD
+		Pass& modify(RGResource resource, RGUsage usage);
+		//keep the pass even if nothing reads its outputs (readbacks, queries)
+		Pass& sideEffect();
+		//run on the async compute queue when there is one, see compile() for when it falls back
+		Pass& async();
+
+		std::string								name;
+		std::function<void(VkCommandBuffer cmd)> execute;
+		std::vector<Access>						accesses;
+		bool									hasSideEffect{ false };
+		bool									culled{ false };
+		RGQueue									queue{ RGQueue::Graphics };
+	};
+public:
+	RenderGraph() = default;
+	~RenderGraph() = default;
+	void init(VkDevice device, VmaAllocator allocator, uint32_t graphicsFamily, uint32_t computeFamily);
+	void destroy();
+	//timelineValue is what this frame's graphics submission signals on the frame timeline
+	void reset(uint64_t timelineValue);
+	//discardContents imports the image in UNDEFINED layout, but still orders it after its last use
+	RGResource importImage(const char* name, VkImage image, VkImageAspectFlags aspect, bool discardContents);
+	//explicit initial state, e.g. a swapchain image whose acquire semaphore is waited at a given stage
+	RGResource importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const ResourceState& initialState);
+	//state is carried over between frames like tracked images
+	RGResource importBuffer(const char* name, VkBuffer buffer);
+	//image owned by the graph, usage flags are derived from the passes using it
+	RGResource createImage(const char* name, const RGImageDesc& desc);
+	//only valid while the graph executes
+	VkImage getImage(RGResource resource) const { return mResources[resource].image; }
+	VkImageView getImageView(RGResource resource) const { return mResources[resource].imageView; }
+	VkBuffer getBuffer(RGResource resource) const { return mResources[resource].buffer; }
+	void markOutput(RGResource resource);
+	void setFinalUsage(RGResource resource, RGUsage usage);
+	Pass& addPass(const char* name, std::function<void(VkCommandBuffer cmd)>&& execute);
+	//async passes are recorded into computeCmd, which may be null to keep everything on cmd.
+	//retireQueue receives transient memory and images the graph stops using
+	void compile(VkCommandBuffer computeCmd, DeletionQueue& retireQueue);
+	//computeCmd has to be recording when the compiled graph has async work
+	void execute(VkCommandBuffer cmd, GpuProfiler* profiler = nullptr);
+	//after compile: whether computeCmd is used, after execute: where the graphics queue waits for it
+	bool hasAsyncWork() const { return mAsyncPassCount > 0; }
+	VkPipelineStageFlags2 asyncWaitStages() const { return mAsyncWaitStages; }
+	//the graphics submission computeCmd has to wait for (0 for none) and the stages its passes run at
+	uint64_t asyncDependencyValue() const { return mAsyncDependencyValue; }
+	VkPipelineStageFlags2 asyncStages() const { return mAsyncStages; }
+	//drop tracked state of an image that is being destroyed
+	void forgetImage(VkImage image);
+	void forgetBuffer(VkBuffer buffer);
+	uint32_t barrierCount() const { return mBarrierCount; }
+	VkDeviceSize transientMemorySize() const { return mTransientPool.blockSize(); }
+private:
+	struct Resource
+	{
+		std::string		   name;
+		VkImage			   image{ nullptr };
+		VkImageView		   imageView{ nullptr };
+		VkBuffer		   buffer{ nullptr };
+		VkImageAspectFlags aspect;
+		ResourceState	   state;
+		bool			   transient{ false };
+		RGImageDesc		   desc{};
+		//index into the transient requests of this frame
+		uint32_t		   transientIndex{ 0 };
+		bool			   firstUse{ true };
+		//state is carried over to the next frame's import of the same image
+		bool			   tracked{ false };
+		bool			   output{ false };
+		bool			   hasFinalUsage{ false };
+		RGUsage			   finalUsage{ RGUsage::Present };
+	};
+	void assignQueues();
+	void allocateTransients(DeletionQueue& retireQueue);
+	ResourceState transientInitialState(const Resource& resource) const;
+	void addBarrier(Resource& resource, const UsageInfo& info, bool write, RGQueue queue, std::vector<VkImageMemoryBarrier2>& barriers);
+	//buffers have no layout and never change queue, see assignQueues
+	void addBufferBarrier(Resource& resource, const UsageInfo& info, bool write);
+	//release on the compute queue, acquire on the graphics queue
+	void transferToGraphics(Resource& resource, const UsageInfo& info, bool write, std::vector<VkImageMemoryBarrier2>& barriers);
+	void flushBarriers(VkCommandBuffer cmd, std::vector<VkImageMemoryBarrier2>& barriers, std::vector<VkBufferMemoryBarrier2>* bufferBarriers = nullptr);
+private:
+	std::vector<Resource>						mResources;
+	std::vector<Pass>							mPasses;
+	std::vector<VkImageMemoryBarrier2>			mBarriers;
+	std::vector<VkImageMemoryBarrier2>			mReleaseBarriers;
+	std::vector<VkBufferMemoryBarrier2>			mBufferBarriers;
+	uint32_t									mGraphicsFamily{ 0 };
+	uint32_t									mComputeFamily{ 0 };
+	VkCommandBuffer								mComputeCmd{ nullptr };
+	uint32_t									mAsyncPassCount{ 0 };
+	VkPipelineStageFlags2						mAsyncWaitStages{ VK_PIPELINE_STAGE_2_NONE };
+	uint64_t									mTimelineValue{ 0 };
+	uint64_t									mAsyncDependencyValue{ 0 };
+	VkPipelineStageFlags2						mAsyncStages{ VK_PIPELINE_STAGE_2_NONE };
+	//state of imported images carried over between frames
+	std::unordered_map<VkImage, ResourceState>	mImageStates;
+	std::unordered_map<VkBuffer, ResourceState> mBufferStates;
+	TransientPool								mTransientPool;
+	std::vector<TransientPool::Request>			mTransientRequests;
+	std::vector<TransientPool::Placement>		mTransientPlacements;
+	//accesses to the transient block by the previous frame, first uses of this frame are ordered after them
+	ResourceState								mTransientBlockState;
+	uint32_t									mBarrierCount{ 0 };
+};
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include "transientPool.h"
+#include "core.h"
+#include "../vkInitializer.h"
+
+namespace
+{
+	constexpr size_t MAX_CACHED_IMAGES = 64;
+
+	bool sameDesc(const RGImageDesc& a, const RGImageDesc& b)
+	{
+		return a.format == b.format && a.aspect == b.aspect &&
+			a.extent.width == b.extent.width && a.extent.height == b.extent.height && a.extent.depth == b.extent.depth;
+	}
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void TransientPool::init(VkDevice device, VmaAllocator allocator)
+{
+	mDevice = device;
+	mAllocator = allocator;
+}
+
+void TransientPool::destroy()
+{
+	for (auto& cached : mImages)
+	{
+		vkDestroyImageView(mDevice, cached.imageView, nullptr);
+		vkDestroyImage(mDevice, cached.image, nullptr);
+	}
+	mImages.clear();
+	mRequirementCache.clear();
+	if (mBlock)
+	{
+		vmaFreeMemory(mAllocator, mBlock);
+		mBlock = nullptr;
+	}
+	mBlockSize = 0;
+}
+
+void TransientPool::retireImages(DeletionQueue& retireQueue, bool unusedOnly)
+{
+	auto iter = std::remove_if(mImages.begin(), mImages.end(), [&](const CachedImage& cached) {
+		if (unusedOnly && cached.used)
+		{
+			return false;
+		}
+		retireQueue.push_back([device = mDevice, image = cached.image, imageView = cached.imageView]() {
+			vkDestroyImageView(device, imageView, nullptr);
+			vkDestroyImage(device, image, nullptr);
+		});
+		return true;
+	});
+	mImages.erase(iter, mImages.end());
+}
+
+const VkMemoryRequirements& TransientPool::imageRequirements(const RGImageDesc& desc, VkImageUsageFlags usage)
+{
+	auto iter = std::find_if(mRequirementCache.begin(), mRequirementCache.end(), [&](const CachedRequirements& cached) {
+		return cached.usage == usage && sameDesc(cached.desc, desc);
+	});
+	if (iter != mRequirementCache.end())
+	{
+		return iter->requirements;
+	}
+	//descriptions of old extents pile up across resizes
+	if (mRequirementCache.size() >= MAX_CACHED_IMAGES)
+	{
+		mRequirementCache.clear();
+	}
+	VkImageCreateInfo imageInfo = VkInitializer::createImageInfo(desc.format, usage, desc.extent);
+	VkDeviceImageMemoryRequirements query{};
+	query.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+	query.pCreateInfo = &imageInfo;
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	vkGetDeviceImageMemoryRequirements(mDevice, &query, &requirements);
+	mRequirementCache.push_back(CachedRequirements{ desc, usage, requirements.memoryRequirements });
+	return mRequirementCache.back().requirements;
+}
+
+void TransientPool::allocate(const std::vector<Request>& requests, std::vector<Placement>& placements, DeletionQueue& retireQueue)
+{
+	placements.assign(requests.size(), Placement{});
+	mRequirements.resize(requests.size());
+	uint32_t memoryTypeBits = ~0u;
+	VkDeviceSize blockAlignment = 1;
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		mRequirements[i] = imageRequirements(requests[i].desc, requests[i].usage);
+		memoryTypeBits &= mRequirements[i].memoryTypeBits;
+		blockAlignment = std::max(blockAlignment, mRequirements[i].alignment);
+	}
+	KS_CORE_ASSERT(requests.empty() || memoryTypeBits != 0, "Transient images have no common memory type");
+
+	//largest first, each image takes the lowest offset not used by an image alive at the same time
+	mOrder.resize(requests.size());
+	for (uint32_t i = 0; i < mOrder.size(); i++)
+	{
+		mOrder[i] = i;
+	}
+	std::sort(mOrder.begin(), mOrder.end(), [&](uint32_t a, uint32_t b) {
+		return mRequirements[a].size > mRequirements[b].size;
+	});
+	VkDeviceSize requiredSize = 0;
+	for (size_t i = 0; i < mOrder.size(); i++)
+	{
+		uint32_t index = mOrder[i];
+		const Request& request = requests[index];
+		VkDeviceSize offset = 0;
+		bool moved = true;
+		while (moved)
+		{
+			moved = false;
+			for (size_t j = 0; j < i; j++)
+			{
+				uint32_t other = mOrder[j];
+				bool aliveTogether = request.firstPass <= requests[other].lastPass && requests[other].firstPass <= request.lastPass;
+				bool memoryOverlaps = offset < placements[other].offset + placements[other].size && placements[other].offset < offset + mRequirements[index].size;
+				if (aliveTogether && memoryOverlaps)
+				{
+					offset = alignUp(placements[other].offset + placements[other].size, mRequirements[index].alignment);
+					moved = true;
+				}
+			}
+		}
+		placements[index].offset = offset;
+		placements[index].size = mRequirements[index].size;
+		requiredSize = std::max(requiredSize, offset + mRequirements[index].size);
+	}
+
+	bool typeCompatible = mBlock && (memoryTypeBits & (1u << mBlockInfo.memoryType));
+	if (requiredSize > mBlockSize || (requiredSize > 0 && !typeCompatible))
+	{
+		//in flight frames may still use the old block, it goes away together with the images bound to it
+		retireImages(retireQueue, false);
+		if (mBlock)
+		{
+			retireQueue.push_back([allocator = mAllocator, block = mBlock]() {
+				vmaFreeMemory(allocator, block);
+			});
+		}
+		VkMemoryRequirements blockRequirements{};
+		blockRequirements.size = requiredSize;
+		blockRequirements.alignment = blockAlignment;
+		blockRequirements.memoryTypeBits = memoryTypeBits;
+		VmaAllocationCreateInfo allocatorInfo{};
+		allocatorInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		allocatorInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VK_CHECK(vmaAllocateMemory(mAllocator, &blockRequirements, &allocatorInfo, &mBlock, &mBlockInfo));
+		mBlockSize = requiredSize;
+		KS_CORE_INFO("Transient memory block: {:.2f} MB", requiredSize / (1024.0 * 1024.0));
+	}
+
+	for (auto& cached : mImages)
+	{
+		cached.used = false;
+	}
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		const Request& request = requests[i];
+		auto iter = std::find_if(mImages.begin(), mImages.end(), [&](const CachedImage& cached) {
+			return !cached.used && cached.offset == placements[i].offset && cached.usage == request.usage && sameDesc(cached.desc, request.desc);
+		});
+		if (iter == mImages.end())
+		{
+			CachedImage cached;
+			cached.desc = request.desc;
+			cached.usage = request.usage;
+			cached.offset = placements[i].offset;
+			VkImageCreateInfo imageInfo = VkInitializer::createImageInfo(request.desc.format, request.usage, request.desc.extent);
+			VK_CHECK(vkCreateImage(mDevice, &imageInfo, nullptr, &cached.image));
+			VK_CHECK(vmaBindImageMemory2(mAllocator, mBlock, cached.offset, cached.image, nullptr));
+			VkImageViewCreateInfo imageViewInfo = VkInitializer::createImageViewInfo(cached.image, request.desc.format, request.desc.aspect, request.desc.extent);
+			VK_CHECK(vkCreateImageView(mDevice, &imageViewInfo, nullptr, &cached.imageView));
+			mImages.push_back(cached);
+			iter = mImages.end() - 1;
+		}
+		iter->used = true;
+		placements[i].image = iter->image;
+		placements[i].imageView = iter->imageView;
+	}
+	//images bound to the block stay valid while unused, only trim when the cache keeps growing
+	if (mImages.size() > MAX_CACHED_IMAGES)
+	{
+		retireImages(retireQueue, true);
+	}
+}
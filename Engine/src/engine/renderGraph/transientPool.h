@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include "../type.h"
+
+struct RGImageDesc
+{
+	VkFormat		   format;
+	VkExtent3D		   extent;
+	VkImageAspectFlags aspect;
+};
+
+//backs the render graph's transient images with a single memory block,
+//images whose pass lifetimes do not overlap are placed at overlapping offsets
+class TransientPool
+{
+public:
+	struct Request
+	{
+		RGImageDesc		  desc;
+		VkImageUsageFlags usage;
+		uint32_t		  firstPass;
+		uint32_t		  lastPass;
+	};
+	struct Placement
+	{
+		VkImage		 image;
+		VkImageView	 imageView;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+public:
+	void init(VkDevice device, VmaAllocator allocator);
+	void destroy();
+	//objects that no longer fit the block are handed to retireQueue, which must outlive the frames using them
+	void allocate(const std::vector<Request>& requests, std::vector<Placement>& placements, DeletionQueue& retireQueue);
+	VkDeviceSize blockSize() const { return mBlockSize; }
+private:
+	struct CachedImage
+	{
+		RGImageDesc		  desc;
+		VkImageUsageFlags usage;
+		VkDeviceSize	  offset;
+		VkImage			  image;
+		VkImageView		  imageView;
+		bool			  used;
+	};
+	struct CachedRequirements
+	{
+		RGImageDesc			 desc;
+		VkImageUsageFlags	 usage;
+		VkMemoryRequirements requirements;
+	};
+	void retireImages(DeletionQueue& retireQueue, bool unusedOnly);
+	//queried once per description, they only change with the image create info
+	const VkMemoryRequirements& imageRequirements(const RGImageDesc& desc, VkImageUsageFlags usage);
+private:
+	VkDevice						  mDevice{ nullptr };
+	VmaAllocator					  mAllocator{ nullptr };
+	VmaAllocation					  mBlock{ nullptr };
+	VmaAllocationInfo				  mBlockInfo{};
+	VkDeviceSize					  mBlockSize{ 0 };
+	std::vector<CachedImage>		  mImages;
+	std::vector<CachedRequirements>	  mRequirementCache;
+	//placement scratch, kept to avoid per frame allocations
+	std::vector<uint32_t>			  mOrder;
+	std::vector<VkMemoryRequirements> mRequirements;
+};
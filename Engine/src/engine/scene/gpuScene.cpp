@@ -0,0 +1,189 @@
+#include <algorithm>
+#include "gpuScene.h"
+#include "core.h"
+#include "../vkInitializer.h"
+
+void GpuScene::init(VkDevice device, VmaAllocator allocator, uint32_t maxObjects, uint32_t maxMeshlets, bool meshletIndices, const std::vector<uint32_t>& queueFamilies)
+{
+	mDevice = device;
+	mAllocator = allocator;
+	mMaxObjects = maxObjects;
+	mMaxMeshlets = maxMeshlets;
+	mQueueFamilies = queueFamilies;
+	uint32_t maxDraws = mMaxObjects + (meshletIndices ? mMaxMeshlets : 0);
+	//only touched by the graphics queue
+	mCommands = VkInitializer::createBuffer(mAllocator, static_cast<size_t>(maxDraws) * sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	mCommandAddress = bufferAddress(mCommands.buffer);
+	mCount = VkInitializer::createBuffer(mAllocator, DRAW_COUNT_SLOTS * sizeof(uint32_t),
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY);
+	mCountAddress = bufferAddress(mCount.buffer);
+	mVisibility = VkInitializer::createBuffer(mAllocator, static_cast<size_t>(mMaxObjects) * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	mVisibilityAddress = bufferAddress(mVisibility.buffer);
+	mSelection = VkInitializer::createBuffer(mAllocator, static_cast<size_t>(mMaxObjects) * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	mSelectionAddress = bufferAddress(mSelection.buffer);
+	size_t meshletIndexSize = meshletIndices ? static_cast<size_t>(mMaxMeshlets) * MESHLET_MAX_TRIANGLES * 3 * sizeof(uint32_t) : 0;
+	if (meshletIndices)
+	{
+		mMeshletIndices = VkInitializer::createBuffer(mAllocator, meshletIndexSize,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		mMeshletIndexAddress = bufferAddress(mMeshletIndices.buffer);
+	}
+	mView = VkInitializer::createBuffer(mAllocator, sizeof(CullView),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	mViewAddress = bufferAddress(mView.buffer);
+	KS_CORE_INFO("Gpu scene: up to {} objects and {} meshlets ({:.2f} MB of draw commands, {:.2f} MB of meshlet indices)", mMaxObjects, mMaxMeshlets,
+		static_cast<double>(maxDraws) * sizeof(VkDrawIndexedIndirectCommand) / (1024.0 * 1024.0), static_cast<double>(meshletIndexSize) / (1024.0 * 1024.0));
+}
+
+void GpuScene::destroy()
+{
+	for (auto& pending : mPending)
+	{
+		vmaDestroyBuffer(mAllocator, pending.buffer.buffer, pending.buffer.allocation);
+	}
+	mPending.clear();
+	if (mObjects.buffer)
+	{
+		vmaDestroyBuffer(mAllocator, mObjects.buffer, mObjects.allocation);
+	}
+	mObjects = {};
+	mObjectCount = 0;
+	mIndex16ObjectCount = 0;
+	mUnmeshedObjectCount = 0;
+	mMeshletCount = 0;
+	mIndex16MeshletCount = 0;
+	vmaDestroyBuffer(mAllocator, mCommands.buffer, mCommands.allocation);
+	vmaDestroyBuffer(mAllocator, mCount.buffer, mCount.allocation);
+	vmaDestroyBuffer(mAllocator, mVisibility.buffer, mVisibility.allocation);
+	vmaDestroyBuffer(mAllocator, mSelection.buffer, mSelection.allocation);
+	if (mMeshletIndices.buffer)
+	{
+		vmaDestroyBuffer(mAllocator, mMeshletIndices.buffer, mMeshletIndices.allocation);
+	}
+	mMeshletIndices = {};
+	vmaDestroyBuffer(mAllocator, mView.buffer, mView.allocation);
+}
+
+VkDeviceAddress GpuScene::bufferAddress(VkBuffer buffer) const
+{
+	VkBufferDeviceAddressInfo addressInfo{};
+	addressInfo.buffer = buffer;
+	addressInfo.pNext = nullptr;
+	addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	return vkGetBufferDeviceAddress(mDevice, &addressInfo);
+}
+
+void GpuScene::setObjects(const std::vector<GpuObject>& objects, const std::vector<GpuMeshlet>& meshlets, UploadTicket dependsOn, UploadManager& uploads)
+{
+	uint32_t count = static_cast<uint32_t>(std::min<size_t>(objects.size(), mMaxObjects));
+	if (count < objects.size())
+	{
+		KS_CORE_ERROR("Gpu scene holds at most {} objects, {} dropped", mMaxObjects, objects.size() - count);
+	}
+	uint32_t index16Count = 0;
+	while (index16Count < count && (objects[index16Count].flags & GPU_OBJECT_INDEX16) != 0)
+	{
+		index16Count++;
+	}
+	KS_CORE_ASSERT(std::none_of(objects.begin() + index16Count, objects.begin() + count, [](const GpuObject& object) { return (object.flags & GPU_OBJECT_INDEX16) != 0; }),
+		"Objects with 16 bit indices have to come first");
+	//every object starts without meshlets, the ones whose meshlets all fit are cleared again
+	std::vector<GpuObject> keptObjects(objects.begin(), objects.begin() + count);
+	for (GpuObject& object : keptObjects)
+	{
+		object.flags |= GPU_OBJECT_NO_MESHLETS;
+	}
+	std::vector<GpuMeshlet> keptMeshlets;
+	keptMeshlets.reserve(std::min<size_t>(meshlets.size(), mMaxMeshlets));
+	for (size_t first = 0; first < meshlets.size();)
+	{
+		uint32_t objectIndex = meshlets[first].objectIndex;
+		size_t end = first;
+		while (end < meshlets.size() && meshlets[end].objectIndex == objectIndex)
+		{
+			end++;
+		}
+		if (objectIndex < count && keptMeshlets.size() + (end - first) <= mMaxMeshlets)
+		{
+			keptMeshlets.insert(keptMeshlets.end(), meshlets.begin() + first, meshlets.begin() + end);
+			keptObjects[objectIndex].flags &= ~GPU_OBJECT_NO_MESHLETS;
+		}
+		first = end;
+	}
+	uint32_t unmeshedCount = static_cast<uint32_t>(std::count_if(keptObjects.begin(), keptObjects.end(), [](const GpuObject& object) {
+		return (object.flags & GPU_OBJECT_NO_MESHLETS) != 0 && object.indexCount > 0;
+	}));
+	if (unmeshedCount > 0 && !meshlets.empty())
+	{
+		KS_CORE_WARN("Gpu scene holds at most {} meshlets, {} objects are drawn without meshlet culling", mMaxMeshlets, unmeshedCount);
+	}
+	uint32_t meshletCount = static_cast<uint32_t>(keptMeshlets.size());
+	//meshlets follow their objects' order, so the 16 bit ones lead as well
+	uint32_t index16MeshletCount = 0;
+	while (index16MeshletCount < meshletCount && keptMeshlets[index16MeshletCount].objectIndex < index16Count)
+	{
+		index16MeshletCount++;
+	}
+	size_t objectSize = static_cast<size_t>(count) * sizeof(GpuObject);
+	size_t meshletSize = static_cast<size_t>(meshletCount) * sizeof(GpuMeshlet);
+	//a fresh buffer each time, frames in flight keep reading the old one
+	PendingObjects pending;
+	pending.buffer = VkInitializer::createBuffer(mAllocator, std::max<size_t>(objectSize + meshletSize, sizeof(GpuObject)),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY, mQueueFamilies);
+	pending.count = count;
+	pending.index16Count = index16Count;
+	pending.unmeshedCount = unmeshedCount;
+	pending.meshletCount = meshletCount;
+	pending.index16MeshletCount = index16MeshletCount;
+	pending.ticket = dependsOn;
+	if (count > 0)
+	{
+		pending.ticket = std::max(pending.ticket, uploads.uploadBuffer(pending.buffer.buffer, 0, keptObjects.data(), objectSize));
+	}
+	if (meshletCount > 0)
+	{
+		pending.ticket = std::max(pending.ticket, uploads.uploadBuffer(pending.buffer.buffer, objectSize, keptMeshlets.data(), meshletSize));
+	}
+	mPending.push_back(pending);
+}
+
+VkBuffer GpuScene::update(uint64_t uploadedValue, DeletionQueue& retireQueue)
+{
+	VkBuffer retired = nullptr;
+	while (!mPending.empty() && mPending.front().ticket <= uploadedValue)
+	{
+		if (mObjects.buffer)
+		{
+			retireQueue.push_back([allocator = mAllocator, buffer = mObjects]() {
+				vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+			});
+			//only the first buffer retired here was drawn with, the others never went live
+			if (!retired)
+			{
+				retired = mObjects.buffer;
+			}
+		}
+		mObjects = mPending.front().buffer;
+		mObjectCount = mPending.front().count;
+		mIndex16ObjectCount = mPending.front().index16Count;
+		mUnmeshedObjectCount = mPending.front().unmeshedCount;
+		mMeshletCount = mPending.front().meshletCount;
+		mIndex16MeshletCount = mPending.front().index16MeshletCount;
+		mObjectAddress = bufferAddress(mObjects.buffer);
+		mNewList = true;
+		mPending.pop_front();
+	}
+	return retired;
+}
+
+bool GpuScene::takeNewList()
+{
+	bool newList = mNewList;
+	mNewList = false;
+	return newList;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <deque>
+#include <vector>
+#include "../type.h"
+#include "../upload/uploadManager.h"
+#include "../culling/meshletBuilder.h"
+
+//firstIndex counts 16 bit indices, setObjects expects these objects in front of the others
+constexpr static uint32_t GPU_OBJECT_INDEX16 = 1;
+//set by setObjects when the object's meshlets did not fit, it gets a plain indexed draw even with meshlet culling on
+constexpr static uint32_t GPU_OBJECT_NO_MESHLETS = 2;
+
+//uints of the count buffer
+constexpr static uint32_t DRAW_COUNT_INDEX16 = 0;
+constexpr static uint32_t DRAW_COUNT_INDEX32 = 1;
+constexpr static uint32_t DRAW_COUNT_MESHLET16 = 2;
+constexpr static uint32_t DRAW_COUNT_MESHLET32 = 3;
+constexpr static uint32_t DRAW_COUNT_SLOTS	   = 4;
+
+//per object record read by the draw command and vertex shaders, std430 layout
+struct GpuObject
+{
+	glm::mat4 model{ 1.0f };
+	uint32_t  firstIndex{ 0 };
+	uint32_t  indexCount{ 0 };
+	int32_t	  vertexOffset{ 0 };
+	//GPU_OBJECT_* bits
+	uint32_t  flags{ 0 };
+	//object space bounding box, w unused
+	glm::vec4 boundsMin{ 0.0f };
+	glm::vec4 boundsMax{ 0.0f };
+	//MeshBuffer::quantization of the vertices, w unused
+	glm::vec4 positionOffset{ 0.0f };
+	glm::vec4 positionScale{ 0.0f };
+};
+static_assert(sizeof(GpuObject) % 16 == 0, "GpuObject must match its std430 array stride");
+
+//one Meshlet of one object, drawn by the mesh shader or expanded to indices by the meshlet cull shader
+struct GpuMeshlet
+{
+	uint32_t  objectIndex{ 0 };
+	//absolute positions of the meshlet's vertex and triangle words in the geometry index buffer
+	uint32_t  vertexOffset{ 0 };
+	uint32_t  triangleOffset{ 0 };
+	//vertexCount in the low 16 bits, triangleCount in the high 16 bits
+	uint32_t  counts{ 0 };
+	//object space, xyz center, w radius
+	glm::vec4 sphere{ 0.0f };
+	glm::vec4 coneApex{ 0.0f };
+	//xyz axis, w cutoff
+	glm::vec4 coneAxis{ 0.0f, 0.0f, 1.0f, 1.0f };
+};
+static_assert(sizeof(GpuMeshlet) % 16 == 0, "GpuMeshlet must match its std430 array stride");
+
+//camera data of the meshlet shaders, rewritten every frame
+struct CullView
+{
+	glm::mat4 viewProj;
+	//xyz world position, w unused
+	glm::vec4 cameraPosition;
+	glm::vec2 viewportSize;
+	glm::vec2 padding;
+};
+
+//everything drawn by the gpu driven geometry pass. objects live in a device local SSBO, a compute
+//pass turns them into VkDrawIndexedIndirectCommands and the geometry pass issues one indirect count draw
+class GpuScene
+{
+public:
+	//meshletIndices allocates the index buffer and meshlet commands of the compute fallback, not needed when mesh
+	//shaders draw the meshlets. maxMeshlets is already clamped to what one dispatch or task draw reaches
+	void init(VkDevice device, VmaAllocator allocator, uint32_t maxObjects, uint32_t maxMeshlets, bool meshletIndices, const std::vector<uint32_t>& queueFamilies);
+	void destroy();
+	//replaces every object and meshlet, the meshlets of one object have to be contiguous. an object keeps all of its
+	//meshlets or none, past maxMeshlets the rest are flagged GPU_OBJECT_NO_MESHLETS. the list goes live once its upload and dependsOn (e.g. the geometry it
+	//references) completed, until then the previous list keeps drawing
+	void setObjects(const std::vector<GpuObject>& objects, const std::vector<GpuMeshlet>& meshlets, UploadTicket dependsOn, UploadManager& uploads);
+	//swaps in the newest list uploaded by uploadedValue, call once per frame. replaced buffers go to
+	//retireQueue, the one the frames so far drew with is returned so its tracked state can be dropped
+	VkBuffer update(uint64_t uploadedValue, DeletionQueue& retireQueue);
+	uint32_t objectCount() const { return mObjectCount; }
+	//leading objects drawn with 16 bit indices
+	uint32_t index16ObjectCount() const { return mIndex16ObjectCount; }
+	//objects flagged GPU_OBJECT_NO_MESHLETS
+	uint32_t unmeshedObjectCount() const { return mUnmeshedObjectCount; }
+	uint32_t maxObjects() const { return mMaxObjects; }
+	uint32_t meshletCount() const { return mMeshletCount; }
+	//leading meshlets of GPU_OBJECT_INDEX16 objects, compacted to 16 bit indices by the fallback
+	uint32_t index16MeshletCount() const { return mIndex16MeshletCount; }
+	uint32_t maxMeshlets() const { return mMaxMeshlets; }
+	//objects followed by the meshlets
+	VkBuffer objectBuffer() const { return mObjects.buffer; }
+	VkDeviceAddress objectAddress() const { return mObjectAddress; }
+	VkDeviceAddress meshletAddress() const { return mObjectAddress + static_cast<VkDeviceAddress>(mObjectCount) * sizeof(GpuObject); }
+	//one VkDrawIndexedIndirectCommand per object, then one per meshlet of the compute fallback.
+	//firstInstance is the object index
+	VkBuffer commandBuffer() const { return mCommands.buffer; }
+	VkDeviceAddress commandAddress() const { return mCommandAddress; }
+	VkDeviceSize meshletCommandOffset() const { return static_cast<VkDeviceSize>(mMaxObjects) * sizeof(VkDrawIndexedIndirectCommand); }
+	//DRAW_COUNT_SLOTS uints, reset every frame before the commands are generated
+	VkBuffer countBuffer() const { return mCount.buffer; }
+	VkDeviceAddress countAddress() const { return mCountAddress; }
+	//one uint per object, whether occlusion culling found it visible last frame
+	VkBuffer visibilityBuffer() const { return mVisibility.buffer; }
+	VkDeviceAddress visibilityAddress() const { return mVisibilityAddress; }
+	//one uint per object, whether the current phase's object cull passed it on to the meshlet stage
+	VkBuffer selectionBuffer() const { return mSelection.buffer; }
+	VkDeviceAddress selectionAddress() const { return mSelectionAddress; }
+	//MESHLET_MAX_TRIANGLES * 3 words per meshlet, the surviving triangles packed at the front as
+	//16 or 32 bit indices depending on the object's index type.
+	//null unless init asked for meshletIndices
+	VkBuffer meshletIndexBuffer() const { return mMeshletIndices.buffer; }
+	VkDeviceAddress meshletIndexAddress() const { return mMeshletIndexAddress; }
+	//a single CullView
+	VkBuffer viewBuffer() const { return mView.buffer; }
+	VkDeviceAddress viewAddress() const { return mViewAddress; }
+	//true once after a new list went live, its visibility has to be cleared before use
+	bool takeNewList();
+private:
+	struct PendingObjects
+	{
+		AllocatedBuffer buffer;
+		uint32_t		count;
+		uint32_t		index16Count;
+		uint32_t		unmeshedCount;
+		uint32_t		meshletCount;
+		uint32_t		index16MeshletCount;
+		UploadTicket	ticket;
+	};
+	VkDeviceAddress bufferAddress(VkBuffer buffer) const;
+private:
+	VkDevice					mDevice{ nullptr };
+	VmaAllocator				mAllocator{ nullptr };
+	uint32_t					mMaxObjects{ 0 };
+	uint32_t					mMaxMeshlets{ 0 };
+	std::vector<uint32_t>		mQueueFamilies;
+	AllocatedBuffer				mObjects{};
+	VkDeviceAddress				mObjectAddress{ 0 };
+	uint32_t					mObjectCount{ 0 };
+	uint32_t					mIndex16ObjectCount{ 0 };
+	uint32_t					mUnmeshedObjectCount{ 0 };
+	uint32_t					mMeshletCount{ 0 };
+	uint32_t					mIndex16MeshletCount{ 0 };
+	AllocatedBuffer				mCommands{};
+	VkDeviceAddress				mCommandAddress{ 0 };
+	AllocatedBuffer				mCount{};
+	VkDeviceAddress				mCountAddress{ 0 };
+	AllocatedBuffer				mVisibility{};
+	VkDeviceAddress				mVisibilityAddress{ 0 };
+	AllocatedBuffer				mSelection{};
+	VkDeviceAddress				mSelectionAddress{ 0 };
+	AllocatedBuffer				mMeshletIndices{};
+	VkDeviceAddress				mMeshletIndexAddress{ 0 };
+	AllocatedBuffer				mView{};
+	VkDeviceAddress				mViewAddress{ 0 };
+	bool						mNewList{ false };
+	//uploads still in flight, oldest first
+	std::deque<PendingObjects>	mPending;
+};
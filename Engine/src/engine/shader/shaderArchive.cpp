@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "shaderArchive.h"
+#include "core.h"
+#include "../utils.h"
+#include "../profiler/cpuProfiler.h"
+
+namespace
+{
+	constexpr uint32_t ARCHIVE_MAGIC = 0x4B535341; //KSSA
+	constexpr uint32_t ARCHIVE_VERSION = 1;
+	constexpr const char* SPIRV_EXTENSION = ".spirv";
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+ShaderArchive::~ShaderArchive()
+{
+	close();
+}
+
+bool ShaderArchive::open(const std::string& path)
+{
+	KS_PROFILE_FUNCTION();
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		KS_CORE_ERROR("Failed to open shader archive {}", path);
+		return false;
+	}
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(file, &fileSize);
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!data)
+	{
+		KS_CORE_ERROR("Failed to map shader archive {}", path);
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	mFile = file;
+	mMapping = mapping;
+	mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		KS_CORE_ERROR("Failed to open shader archive {}", path);
+		return false;
+	}
+	struct stat fileStat{};
+	fstat(file, &fileStat);
+	void* data = fileStat.st_size > 0 ? mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	//the mapping keeps the file referenced
+	::close(file);
+	if (data == MAP_FAILED)
+	{
+		KS_CORE_ERROR("Failed to map shader archive {}", path);
+		return false;
+	}
+	mMapping = data;
+	mSize = static_cast<size_t>(fileStat.st_size);
+#endif
+	mData = static_cast<const uint8_t*>(data);
+
+	const Header* header = reinterpret_cast<const Header*>(mData);
+	bool valid = mSize >= sizeof(Header) && header->magic == ARCHIVE_MAGIC && header->version == ARCHIVE_VERSION &&
+		header->blobAlignment == BLOB_ALIGNMENT && sizeof(Header) + static_cast<uint64_t>(header->entryCount) * sizeof(Entry) <= mSize;
+	if (!valid)
+	{
+		KS_CORE_ERROR("Shader archive {} has an unknown format", path);
+		close();
+		return false;
+	}
+	const Entry* entries = reinterpret_cast<const Entry*>(mData + sizeof(Header));
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		const Entry& entry = entries[i];
+		bool inBounds = entry.offset % BLOB_ALIGNMENT == 0 && entry.size % sizeof(uint32_t) == 0 && entry.offset + entry.size <= mSize;
+		if (!inBounds)
+		{
+			KS_CORE_ERROR("Shader archive {} is truncated", path);
+			close();
+			return false;
+		}
+		mIndex.emplace(std::string(entry.name, strnlen(entry.name, sizeof(entry.name))), i);
+	}
+	KS_CORE_INFO("Shader archive {}: {} shaders, {} KB", path, mIndex.size(), mSize / 1024);
+	return true;
+}
+
+void ShaderArchive::close()
+{
+	if (mData)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+		CloseHandle(static_cast<HANDLE>(mMapping));
+		CloseHandle(static_cast<HANDLE>(mFile));
+#else
+		munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+	}
+	mData = nullptr;
+	mSize = 0;
+	mFile = nullptr;
+	mMapping = nullptr;
+	mIndex.clear();
+}
+
+bool ShaderArchive::find(const std::string& name, Blob& blob) const
+{
+	auto iter = mIndex.find(name);
+	if (iter == mIndex.end())
+	{
+		return false;
+	}
+	const Entry& entry = reinterpret_cast<const Entry*>(mData + sizeof(Header))[iter->second];
+	blob.code = reinterpret_cast<const uint32_t*>(mData + entry.offset);
+	blob.size = static_cast<size_t>(entry.size);
+	blob.contentHash = entry.contentHash;
+	return true;
+}
+
+bool ShaderArchive::isStale(const std::string& spirvDirectory, const std::string& archivePath)
+{
+	std::error_code error;
+	if (!std::filesystem::exists(archivePath, error))
+	{
+		return true;
+	}
+	auto archiveTime = std::filesystem::last_write_time(archivePath, error);
+	for (const auto& file : std::filesystem::directory_iterator(spirvDirectory, error))
+	{
+		if (file.path().extension() == SPIRV_EXTENSION && file.last_write_time(error) > archiveTime)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ShaderArchive::pack(const std::string& spirvDirectory, const std::string& archivePath)
+{
+	KS_PROFILE_FUNCTION();
+	std::vector<std::filesystem::path> files;
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(spirvDirectory, error))
+	{
+		if (file.path().extension() == SPIRV_EXTENSION)
+		{
+			files.push_back(file.path());
+		}
+	}
+	if (error)
+	{
+		KS_CORE_ERROR("Failed to list shaders in {}: {}", spirvDirectory, error.message());
+		return false;
+	}
+	//sorted so the same inputs always produce the same archive
+	std::sort(files.begin(), files.end());
+
+	std::vector<Entry> entries(files.size());
+	std::vector<std::vector<char>> blobs;
+	std::vector<uint64_t> blobOffsets;
+	std::vector<uint64_t> blobHashes;
+	uint64_t offset = alignUp(sizeof(Header) + entries.size() * sizeof(Entry), BLOB_ALIGNMENT);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		std::string name = files[i].stem().string();
+		if (name.size() > MAX_NAME_LENGTH)
+		{
+			KS_CORE_ERROR("Shader name {} is too long for the archive", name);
+			return false;
+		}
+		std::ifstream file(files[i], std::ios::ate | std::ios::binary);
+		std::vector<char> code(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(code.data(), code.size());
+		if (!file || code.size() % sizeof(uint32_t) != 0)
+		{
+			KS_CORE_ERROR("Failed to read shader {}", files[i].string());
+			return false;
+		}
+		Entry& entry = entries[i];
+		memset(&entry, 0, sizeof(Entry));
+		memcpy(entry.name, name.data(), name.size());
+		entry.contentHash = Utils::hashBytes(code.data(), code.size());
+		entry.size = code.size();
+		//shaders compiled to the same SPIR-V share one blob, the hash only narrows down the byte compare
+		size_t same = 0;
+		while (same < blobs.size() && (blobHashes[same] != entry.contentHash || blobs[same].size() != code.size() ||
+			memcmp(blobs[same].data(), code.data(), code.size()) != 0))
+		{
+			same++;
+		}
+		if (same < blobs.size())
+		{
+			entry.offset = blobOffsets[same];
+			continue;
+		}
+		entry.offset = offset;
+		offset = alignUp(offset + code.size(), BLOB_ALIGNMENT);
+		blobOffsets.push_back(entry.offset);
+		blobHashes.push_back(entry.contentHash);
+		blobs.push_back(std::move(code));
+	}
+
+	Header header{};
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.blobAlignment = BLOB_ALIGNMENT;
+	//same tmp and rename scheme as the pipeline cache, a running engine never maps a half written archive
+	std::string tmpPath = archivePath + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			KS_CORE_ERROR("Failed to open {} for writing", tmpPath);
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		const char padding[BLOB_ALIGNMENT]{};
+		for (size_t i = 0; i < blobs.size(); i++)
+		{
+			uint64_t position = static_cast<uint64_t>(file.tellp());
+			file.write(padding, blobOffsets[i] - position);
+			file.write(blobs[i].data(), blobs[i].size());
+		}
+		file.flush();
+		if (!file)
+		{
+			KS_CORE_ERROR("Failed to write shader archive {}", tmpPath);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, archivePath, error);
+	if (error)
+	{
+		KS_CORE_ERROR("Failed to replace shader archive {}: {}", archivePath, error.message());
+		std::filesystem::remove(tmpPath, error);
+		return false;
+	}
+	KS_CORE_INFO("Packed {} shaders ({} unique) into {}", entries.size(), blobs.size(), archivePath);
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+//every SPIR-V blob of the engine packed in one file: header, index, then blobs aligned to BLOB_ALIGNMENT.
+//the file is memory mapped once and blobs are handed out as pointers into the mapping
+class ShaderArchive
+{
+public:
+	struct Blob
+	{
+		const uint32_t* code{ nullptr };
+		size_t			size{ 0 };
+		uint64_t		contentHash{ 0 };
+	};
+	constexpr static uint32_t BLOB_ALIGNMENT = 16;
+	constexpr static size_t MAX_NAME_LENGTH = 55;
+public:
+	ShaderArchive() = default;
+	~ShaderArchive();
+	ShaderArchive(const ShaderArchive&) = delete;
+	ShaderArchive& operator=(const ShaderArchive&) = delete;
+	bool open(const std::string& path);
+	void close();
+	//shaders are looked up by their file name without the .spirv extension, e.g. grid.comp
+	bool find(const std::string& name, Blob& blob) const;
+	uint32_t shaderCount() const { return static_cast<uint32_t>(mIndex.size()); }
+	//packs every .spirv file of spirvDirectory, identical blobs are stored once
+	static bool pack(const std::string& spirvDirectory, const std::string& archivePath);
+	//true when the archive is missing or older than any .spirv file of spirvDirectory
+	static bool isStale(const std::string& spirvDirectory, const std::string& archivePath);
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t blobAlignment;
+	};
+	struct Entry
+	{
+		char	 name[MAX_NAME_LENGTH + 1];
+		uint64_t contentHash;
+		uint64_t offset;
+		uint64_t size;
+	};
+private:
+	const uint8_t*							  mData{ nullptr };
+	size_t									  mSize{ 0 };
+	//platform mapping handles
+	void*									  mFile{ nullptr };
+	void*									  mMapping{ nullptr };
+	std::unordered_map<std::string, uint32_t> mIndex;
+};
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "shaderModuleCache.h"
+#include "shaderArchive.h"
+#include "core.h"
+#include "../utils.h"
+
+void ShaderModuleCache::init(VkDevice device, const ShaderArchive* archive)
+{
+	mDevice = device;
+	mArchive = archive;
+}
+
+void ShaderModuleCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& [hash, module] : mModules)
+	{
+		vkDestroyShaderModule(mDevice, module, nullptr);
+	}
+	mModules.clear();
+	mOverrides.clear();
+	mNameHashes.clear();
+	mSuperseded.clear();
+}
+
+void ShaderModuleCache::replace(const std::string& name, std::vector<uint32_t>&& code)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Override& entry = mOverrides[name];
+	entry.contentHash = Utils::hashBytes(code.data(), code.size() * sizeof(uint32_t));
+	entry.code = std::move(code);
+	auto previous = mNameHashes.find(name);
+	if (previous != mNameHashes.end() && previous->second != entry.contentHash)
+	{
+		mSuperseded.push_back(previous->second);
+		previous->second = entry.contentHash;
+	}
+}
+
+void ShaderModuleCache::retireSuperseded(DeletionQueue& retireQueue)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (uint64_t hash : mSuperseded)
+	{
+		//shaders compiled to the same SPIR-V share the module, it stays while any of them resolves to it
+		bool referenced = std::any_of(mNameHashes.begin(), mNameHashes.end(), [hash](const auto& entry) { return entry.second == hash; });
+		auto iter = mModules.find(hash);
+		if (referenced || iter == mModules.end())
+		{
+			continue;
+		}
+		retireQueue.push_back([device = mDevice, module = iter->second]() {
+			vkDestroyShaderModule(device, module, nullptr);
+		});
+		mModules.erase(iter);
+	}
+	mSuperseded.clear();
+}
+
+VkShaderModule ShaderModuleCache::get(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	ShaderArchive::Blob blob;
+	auto overrideIter = mOverrides.find(name);
+	if (overrideIter != mOverrides.end())
+	{
+		blob.code = overrideIter->second.code.data();
+		blob.size = overrideIter->second.code.size() * sizeof(uint32_t);
+		blob.contentHash = overrideIter->second.contentHash;
+	}
+	else if (!mArchive->find(name, blob))
+	{
+		KS_CORE_ERROR("Shader {} is not in the archive", name);
+		KS_CORE_ASSERT(false, "Missing shader");
+		return nullptr;
+	}
+	mNameHashes[name] = blob.contentHash;
+	auto iter = mModules.find(blob.contentHash);
+	if (iter != mModules.end())
+	{
+		return iter->second;
+	}
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.pNext = nullptr;
+	createInfo.flags = 0;
+	createInfo.pCode = blob.code;
+	createInfo.codeSize = blob.size;
+	VkShaderModule module;
+	VK_CHECK(vkCreateShaderModule(mDevice, &createInfo, nullptr, &module));
+	mModules.emplace(blob.contentHash, module);
+	return module;
+}
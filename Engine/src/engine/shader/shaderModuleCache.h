@@ -0,0 +1,41 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../type.h"
+
+class ShaderArchive;
+
+//VkShaderModules created straight from the archive mapping, one per distinct SPIR-V content hash.
+//safe to call from the pipeline workers
+class ShaderModuleCache
+{
+public:
+	void init(VkDevice device, const ShaderArchive* archive);
+	void destroy();
+	//the module stays owned by the cache
+	VkShaderModule get(const std::string& name);
+	//hot reload: name resolves to code instead of the archive blob from now on
+	void replace(const std::string& name, std::vector<uint32_t>&& code);
+	//destroys the modules replace left without a name through retireQueue. only call while no pipeline
+	//is compiling, a worker may still be creating one from a superseded module
+	void retireSuperseded(DeletionQueue& retireQueue);
+	uint32_t moduleCount() const { return static_cast<uint32_t>(mModules.size()); }
+private:
+	struct Override
+	{
+		std::vector<uint32_t> code;
+		uint64_t			  contentHash;
+	};
+private:
+	VkDevice									 mDevice{ nullptr };
+	const ShaderArchive*						 mArchive{ nullptr };
+	std::mutex									 mMutex;
+	std::unordered_map<uint64_t, VkShaderModule> mModules;
+	std::unordered_map<std::string, Override>	 mOverrides;
+	//content hash each name resolves to, modules only live while some name still does
+	std::unordered_map<std::string, uint64_t>	 mNameHashes;
+	std::vector<uint64_t>						 mSuperseded;
+};
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include "shaderWatcher.h"
+#include "core.h"
+#include "../profiler/cpuProfiler.h"
+
+namespace
+{
+	constexpr auto POLL_INTERVAL = std::chrono::milliseconds(500);
+	constexpr int WATCH_TIMEOUT_MS = 250;
+	//editors write a file in several steps, wait for the burst to settle
+	constexpr auto DEBOUNCE_DELAY = std::chrono::milliseconds(50);
+
+	bool isShaderSource(const std::filesystem::path& path)
+	{
+		static const char* extensions[] = { ".comp", ".vert", ".frag", ".geom", ".tesc", ".tese", ".mesh", ".task" };
+		std::string extension = path.extension().string();
+		return std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions);
+	}
+
+	int64_t writeTime(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		return static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	}
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	stop();
+}
+
+bool ShaderWatcher::start(const std::string& sourceDirectory, const std::string& spirvDirectory)
+{
+	std::error_code error;
+	if (!std::filesystem::is_directory(sourceDirectory, error))
+	{
+		KS_CORE_WARN("Shader hot reload disabled, {} does not exist", sourceDirectory);
+		return false;
+	}
+	mSourceDirectory = sourceDirectory;
+	mSpirvDirectory = spirvDirectory;
+	//same compiler the project's custom build step uses
+	const char* sdk = std::getenv("VULKAN_SDK");
+#ifdef _WIN32
+	std::filesystem::path sdkCompiler = sdk ? std::filesystem::path(sdk) / "Bin" / "glslc.exe" : std::filesystem::path();
+#else
+	std::filesystem::path sdkCompiler = sdk ? std::filesystem::path(sdk) / "bin" / "glslc" : std::filesystem::path();
+#endif
+	mCompiler = !sdkCompiler.empty() && std::filesystem::exists(sdkCompiler, error) ? sdkCompiler.string() : "glslc";
+
+#ifdef __linux__
+	mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (mInotify >= 0 && inotify_add_watch(mInotify, mSourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(mInotify);
+		mInotify = -1;
+	}
+#endif
+	if (mInotify < 0)
+	{
+		mWriteTimes.clear();
+		for (const auto& file : std::filesystem::directory_iterator(mSourceDirectory, error))
+		{
+			if (isShaderSource(file.path()))
+			{
+				mWriteTimes.emplace_back(file.path().filename().string(), writeTime(file.path()));
+			}
+		}
+	}
+	mStopping = false;
+	mThread = std::thread([this]() { watchLoop(); });
+	KS_CORE_INFO("Watching {} for shader changes ({})", mSourceDirectory, mInotify >= 0 ? "inotify" : "polling");
+	return true;
+}
+
+void ShaderWatcher::stop()
+{
+	if (!mThread.joinable())
+	{
+		return;
+	}
+	mStopping = true;
+	mThread.join();
+#ifdef __linux__
+	if (mInotify >= 0)
+	{
+		close(mInotify);
+		mInotify = -1;
+	}
+#endif
+}
+
+void ShaderWatcher::poll(std::vector<CompiledShader>& compiled)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& shader : mCompiled)
+	{
+		compiled.push_back(std::move(shader));
+	}
+	mCompiled.clear();
+}
+
+void ShaderWatcher::collectChanges(std::vector<std::string>& changed)
+{
+#ifdef __linux__
+	if (mInotify >= 0)
+	{
+		pollfd descriptor{ mInotify, POLLIN, 0 };
+		if (::poll(&descriptor, 1, WATCH_TIMEOUT_MS) <= 0)
+		{
+			return;
+		}
+		std::this_thread::sleep_for(DEBOUNCE_DELAY);
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(mInotify, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+			{
+				const inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+				if (event->len > 0 && isShaderSource(event->name))
+				{
+					changed.push_back(event->name);
+				}
+			}
+		}
+		return;
+	}
+#endif
+	std::this_thread::sleep_for(POLL_INTERVAL);
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(mSourceDirectory, error))
+	{
+		if (!isShaderSource(file.path()))
+		{
+			continue;
+		}
+		std::string name = file.path().filename().string();
+		int64_t time = writeTime(file.path());
+		auto iter = std::find_if(mWriteTimes.begin(), mWriteTimes.end(), [&](const auto& seen) { return seen.first == name; });
+		if (iter == mWriteTimes.end())
+		{
+			mWriteTimes.emplace_back(name, time);
+			changed.push_back(name);
+		}
+		else if (iter->second != time)
+		{
+			iter->second = time;
+			changed.push_back(name);
+		}
+	}
+}
+
+void ShaderWatcher::watchLoop()
+{
+	KS_PROFILE_THREAD("shader watcher");
+	std::vector<std::string> changed;
+	while (!mStopping)
+	{
+		changed.clear();
+		collectChanges(changed);
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+		for (const auto& name : changed)
+		{
+			CompiledShader compiled;
+			if (compile(name, compiled))
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mCompiled.push_back(std::move(compiled));
+			}
+		}
+	}
+}
+
+bool ShaderWatcher::compile(const std::string& name, CompiledShader& compiled)
+{
+	KS_PROFILE_FUNCTION();
+	std::filesystem::path source = std::filesystem::path(mSourceDirectory) / name;
+	std::filesystem::path output = std::filesystem::path(mSpirvDirectory) / (name + ".spirv");
+	//mesh and task stages need SPIR-V 1.4, the project's custom build step passes the same flag
+	std::string extension = source.extension().string();
+	std::string targetEnv = extension == ".mesh" || extension == ".task" ? " --target-env=vulkan1.3" : "";
+	std::string command = "\"" + mCompiler + "\" \"" + source.string() + "\"" + targetEnv + " -o \"" + output.string() + "\"";
+#ifdef _WIN32
+	//cmd.exe strips the outer quotes of the whole line
+	command = "\"" + command + "\"";
+#endif
+	auto start = std::chrono::steady_clock::now();
+	if (std::system(command.c_str()) != 0)
+	{
+		//glslc already printed the diagnostics, keep running the last good version
+		KS_CORE_ERROR("Shader {} failed to compile", name);
+		return false;
+	}
+	std::ifstream file(output, std::ios::ate | std::ios::binary);
+	size_t fileSize = file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+	if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+	{
+		KS_CORE_ERROR("Failed to read compiled shader {}", output.string());
+		return false;
+	}
+	compiled.name = name;
+	compiled.code.resize(fileSize / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(compiled.code.data()), fileSize);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	KS_CORE_INFO("Recompiled shader {} in {:.1f} ms", name, ms);
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//watches the GLSL sources and recompiles changed files with glslc on its own thread.
+//uses inotify on linux and polls modification times everywhere else
+class ShaderWatcher
+{
+public:
+	struct CompiledShader
+	{
+		//source file name, which is also the shader's archive name, e.g. grid.comp
+		std::string			  name;
+		std::vector<uint32_t> code;
+	};
+public:
+	~ShaderWatcher();
+	//compiled SPIR-V is also written to spirvDirectory so the next launch repacks the archive
+	bool start(const std::string& sourceDirectory, const std::string& spirvDirectory);
+	void stop();
+	bool running() const { return mThread.joinable(); }
+	//moves out the shaders compiled since the last call, never blocks
+	void poll(std::vector<CompiledShader>& compiled);
+private:
+	void watchLoop();
+	void collectChanges(std::vector<std::string>& changed);
+	bool compile(const std::string& name, CompiledShader& compiled);
+private:
+	std::string					mSourceDirectory;
+	std::string					mSpirvDirectory;
+	std::string					mCompiler;
+	std::thread					mThread;
+	std::atomic<bool>			mStopping{ false };
+	std::mutex					mMutex;
+	std::vector<CompiledShader> mCompiled;
+	int							mInotify{ -1 };
+	//polling fallback, source name and its last seen write time
+	std::vector<std::pair<std::string, int64_t>> mWriteTimes;
+};
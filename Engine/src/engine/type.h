@@ -3,6 +3,7 @@
 #include <vk_mem_alloc.h>
 #include <deque>
 #include <functional>
+#include <vector>
 #include <glm.hpp>
 
 struct DeletionQueue
@@ -39,27 +40,145 @@ struct AllocatedBuffer
 	VmaAllocationInfo allocationInfo;
 };
 
+//full precision vertex the loader produces, packed into a PackedVertex on upload
 struct Vertex
 {
-	glm::vec4 position;
-	glm::vec4 color;
+	glm::vec3 position;
+	glm::vec3 normal;
+	//xyz tangent, w bitangent sign
+	glm::vec4 tangent;
+	glm::vec2 uv;
+};
+
+//layout of the geometry vertex buffer, the shaders fetch it as a uvec4 through buffer_reference
+struct PackedVertex
+{
+	//unorm16 inside the mesh's bounds, see VertexQuantization
+	uint16_t position[3];
+	//bit 0: negative bitangent sign
+	uint16_t flags;
+	//octahedral encoded, two snorm8 each: normal in the low 16 bits, tangent in the high 16 bits
+	uint32_t normalTangent;
+	//two halfs
+	uint32_t uv;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the uvec4 the shaders fetch");
+
+//per mesh dequantization of PackedVertex::position, object space = offset + unorm * scale
+struct VertexQuantization
+{
+	glm::vec3 offset{ 0.0f };
+	glm::vec3 scale{ 0.0f };
+};
+
+//sub-allocation of the GeometryBuffer, in vertices and 32 bit index buffer words
+struct GeometryRange
+{
+	uint32_t	vertexOffset{ 0 };
+	uint32_t	vertexCount{ 0 };
+	uint32_t	firstIndex{ 0 };
+	uint32_t	indexCount{ 0 };
+	//VK_INDEX_TYPE_UINT16 ranges pack two indices per word
+	VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };
 };
 
 struct MeshBuffer
 {
-	AllocatedBuffer vertexBuffer;
-	AllocatedBuffer indexBuffer;
+	GeometryRange	geometry;
+	//base address of the shared vertex buffer, vertices are addressed through vertexOffset
 	VkDeviceAddress vertexAddress;
+	//the meshlet stream follows the indices in the same range, offset from geometry.firstIndex
+	uint32_t		meshletDataOffset{ 0 };
+	VertexQuantization quantization;
+	//UploadTicket of the vertex/index copies, don't draw before it completed
+	uint64_t		uploadTicket{ 0 };
 };
 
 struct BackGroundPushConstants
 {
-	glm::vec4 topColor;
-	glm::vec4 bottomColor;
+	glm::vec4  topColor;
+	glm::vec4  bottomColor;
+	glm::ivec2 drawExtent;
+	//bindless storage image handle of the draw image
+	uint32_t   drawImage;
+};
+
+struct ReadbackImage
+{
+	uint32_t			 frameNumber;
+	VkExtent3D			 extent;
+	VkFormat			 format;
+	std::vector<uint8_t> pixels;
+};
+
+using ReadbackCallback = std::function<void(const ReadbackImage&)>;
+
+struct DrawPushConstants
+{
+	glm::mat4		viewProj{ 1.0 };
+	VkDeviceAddress vertexAddress;
+	//GpuObject array, indexed by the instance index
+	VkDeviceAddress objectAddress;
+};
+
+//which objects a drawCommands dispatch emits
+enum class CullPhase : uint32_t
+{
+	//frustum test only, occlusion culling disabled
+	FrustumOnly,
+	//objects visible last frame, drawn to build this frame's depth pyramid
+	Early,
+	//every object tested against the pyramid, draws the newly visible ones and records visibility
+	Late,
+};
+
+struct DrawCommandPushConstants
+{
+	glm::mat4		viewProj;
+	VkDeviceAddress objectAddress;
+	VkDeviceAddress commandAddress;
+	VkDeviceAddress countAddress;
+	VkDeviceAddress visibilityAddress;
+	VkDeviceAddress selectionAddress;
+	uint32_t		objectCount;
+	CullPhase		phase;
+	uint32_t		depthPyramid;
+	uint32_t		depthSampler;
+	//1: only mark the selection buffer of objects with meshlets, the meshlet cull or the task shader emits their draws
+	uint32_t		selectMeshlets;
+	//objects with 16 bit indices come first, the 32 bit commands are written behind theirs
+	uint32_t		index16ObjectCount;
+};
+
+struct MeshletCullPushConstants
+{
+	VkDeviceAddress viewAddress;
+	//objects and meshlets live in the same buffer
+	VkDeviceAddress objectAddress;
+	VkDeviceAddress meshletAddress;
+	VkDeviceAddress indexAddress;
+	VkDeviceAddress vertexAddress;
+	VkDeviceAddress selectionAddress;
+	VkDeviceAddress meshletIndexAddress;
+	//the meshlet commands behind the object commands and their DRAW_COUNT_MESHLET16 / 32 slots
+	VkDeviceAddress commandAddress;
+	VkDeviceAddress countAddress;
+	uint32_t		meshletCount;
+	//the 32 bit commands are written behind room for these
+	uint32_t		index16MeshletCount;
+	//0 in wireframe, lines show back faces and sub pixel triangles too
+	uint32_t		faceCulling;
 };
 
-struct ModelStruct
+struct MeshletDrawPushConstants
 {
-	glm::mat4		modelMatrix{1.0};
+	VkDeviceAddress viewAddress;
+	VkDeviceAddress objectAddress;
+	VkDeviceAddress meshletAddress;
+	VkDeviceAddress indexAddress;
 	VkDeviceAddress vertexAddress;
+	VkDeviceAddress selectionAddress;
+	uint32_t		meshletCount;
+	//see MeshletCullPushConstants
+	uint32_t		faceCulling;
 };
\ No newline at end of file
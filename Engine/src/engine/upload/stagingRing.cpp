@@ -0,0 +1,80 @@
+#include <algorithm>
+#include "stagingRing.h"
+#include "core.h"
+#include "../vkInitializer.h"
+
+namespace
+{
+	constexpr VkDeviceSize ALIGNMENT = 16;
+	//a region shorter than this at the end of the buffer is skipped when the start has more room
+	constexpr VkDeviceSize MIN_CHUNK = 64 * 1024;
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void StagingRing::init(VmaAllocator allocator, VkDeviceSize capacity)
+{
+	mAllocator = allocator;
+	mCapacity = alignUp(capacity, ALIGNMENT);
+	mBuffer = VkInitializer::createBuffer(mAllocator, mCapacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	KS_CORE_INFO("Staging ring: {:.2f} MB", mCapacity / (1024.0 * 1024.0));
+}
+
+void StagingRing::destroy()
+{
+	vmaDestroyBuffer(mAllocator, mBuffer.buffer, mBuffer.allocation);
+	mMarks.clear();
+	mHead = mTail = 0;
+}
+
+StagingRing::Region StagingRing::allocate(VkDeviceSize size)
+{
+	Region region{ 0, 0, nullptr };
+	uint64_t position = alignUp(mHead, ALIGNMENT);
+	if (position - mTail >= mCapacity)
+	{
+		return region;
+	}
+	uint64_t offset = position % mCapacity;
+	uint64_t free = mCapacity - (position - mTail);
+	uint64_t toEnd = mCapacity - offset;
+	uint64_t contiguous = std::min(toEnd, free);
+	if (contiguous < std::min<uint64_t>(size, MIN_CHUNK) && free > toEnd)
+	{
+		//wrap around, the skipped bytes are released together with this region
+		position += toEnd;
+		offset = 0;
+		contiguous = free - toEnd;
+	}
+	region.offset = offset;
+	region.size = std::min<uint64_t>(size, contiguous);
+	region.mapped = static_cast<char*>(mBuffer.allocationInfo.pMappedData) + offset;
+	mHead = position + region.size;
+	return region;
+}
+
+void StagingRing::flush(const Region& region)
+{
+	//no-op on coherent memory
+	vmaFlushAllocation(mAllocator, mBuffer.allocation, region.offset, region.size);
+}
+
+void StagingRing::close(uint64_t ticket)
+{
+	if (mMarks.empty() || mMarks.back().end != mHead)
+	{
+		mMarks.push_back(Mark{ ticket, mHead });
+	}
+}
+
+void StagingRing::release(uint64_t completedTicket)
+{
+	while (!mMarks.empty() && mMarks.front().ticket <= completedTicket)
+	{
+		mTail = mMarks.front().end;
+		mMarks.pop_front();
+	}
+}
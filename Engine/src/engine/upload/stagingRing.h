@@ -0,0 +1,44 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <deque>
+#include "../type.h"
+
+//one persistently mapped staging buffer handed out front to back. regions are grouped by the
+//ticket of the batch that consumes them and come back once the upload timeline passes that ticket
+class StagingRing
+{
+public:
+	struct Region
+	{
+		VkDeviceSize offset;
+		//may be smaller than requested, 0 when the ring is full
+		VkDeviceSize size;
+		void*		 mapped;
+	};
+public:
+	void init(VmaAllocator allocator, VkDeviceSize capacity);
+	void destroy();
+	Region allocate(VkDeviceSize size);
+	void flush(const Region& region);
+	//everything allocated since the last close belongs to ticket
+	void close(uint64_t ticket);
+	void release(uint64_t completedTicket);
+	VkBuffer buffer() const { return mBuffer.buffer; }
+	VkDeviceSize capacity() const { return mCapacity; }
+	VkDeviceSize used() const { return mHead - mTail; }
+private:
+	struct Mark
+	{
+		uint64_t ticket;
+		uint64_t end;
+	};
+private:
+	VmaAllocator	 mAllocator{ nullptr };
+	AllocatedBuffer	 mBuffer{};
+	VkDeviceSize	 mCapacity{ 0 };
+	//monotonic positions, the offset in the buffer is position % mCapacity
+	uint64_t		 mHead{ 0 };
+	uint64_t		 mTail{ 0 };
+	std::deque<Mark> mMarks;
+};
@@ -0,0 +1,157 @@
+#include <cstring>
+#include "uploadManager.h"
+#include "core.h"
+#include "../vkInitializer.h"
+#include "../profiler/cpuProfiler.h"
+
+void UploadManager::init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamilyIndex, VkDeviceSize stagingSize)
+{
+	mDevice = device;
+	mAllocator = allocator;
+	mQueue = queue;
+	mQueueFamilyIndex = queueFamilyIndex;
+	VkCommandPoolCreateInfo poolInfo = VkInitializer::createCommandPoolInfo(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	VK_CHECK(vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool));
+	VkSemaphoreTypeCreateInfo timelineTypeInfo = VkInitializer::createSemaphoreTypeInfo(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+	VkSemaphoreCreateInfo timelineInfo = VkInitializer::createSemaphoreInfo(0);
+	timelineInfo.pNext = &timelineTypeInfo;
+	VK_CHECK(vkCreateSemaphore(mDevice, &timelineInfo, nullptr, &mTimeline));
+	mStaging.init(allocator, stagingSize);
+}
+
+void UploadManager::destroy()
+{
+	//anything still staged is dropped, its destination buffers may already be gone
+	wait(mSubmittedValue);
+	mPendingCopies.clear();
+	mStaging.destroy();
+	vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+	vkDestroySemaphore(mDevice, mTimeline, nullptr);
+	mFreeCommandBuffers.clear();
+}
+
+UploadTicket UploadManager::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	const char* src = static_cast<const char*>(data);
+	VkDeviceSize done = 0;
+	while (done < size)
+	{
+		StagingRing::Region region = mStaging.allocate(size - done);
+		if (region.size == 0)
+		{
+			//ring is full: push out what is staged and wait for the oldest batch to hand its space back
+			flush();
+			KS_CORE_ASSERT(!mInFlight.empty(), "Staging ring full without uploads in flight");
+			wait(mInFlight.front().ticket);
+			continue;
+		}
+		memcpy(region.mapped, src + done, region.size);
+		mStaging.flush(region);
+		mPendingCopies.push_back(PendingCopy{ dstBuffer, dstOffset + done, region.offset, region.size });
+		mPendingBytes += region.size;
+		done += region.size;
+	}
+	//keep the transfer queue busy instead of letting half the ring wait for the next update()
+	if (mPendingBytes >= mStaging.capacity() / 2)
+	{
+		return flush();
+	}
+	return mSubmittedValue + 1;
+}
+
+UploadTicket UploadManager::flush()
+{
+	if (mPendingCopies.empty())
+	{
+		return mSubmittedValue;
+	}
+	KS_PROFILE_FUNCTION();
+	Batch batch;
+	if (mFreeCommandBuffers.empty())
+	{
+		VkCommandBufferAllocateInfo commandInfo = VkInitializer::createCommandBufferInfo(mCommandPool);
+		VK_CHECK(vkAllocateCommandBuffers(mDevice, &commandInfo, &batch.commandBuffer));
+	}
+	else
+	{
+		batch.commandBuffer = mFreeCommandBuffers.back();
+		mFreeCommandBuffers.pop_back();
+		VK_CHECK(vkResetCommandBuffer(batch.commandBuffer, 0));
+	}
+	VkCommandBufferBeginInfo beginInfo = VkInitializer::createCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	VK_CHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+	//everything comes out of the ring, one copy command per run of chunks with the same destination
+	for (size_t i = 0; i < mPendingCopies.size(); i++)
+	{
+		const PendingCopy& pending = mPendingCopies[i];
+		VkBufferCopy2 copyRegion{};
+		copyRegion.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
+		copyRegion.pNext = nullptr;
+		copyRegion.srcOffset = pending.srcOffset;
+		copyRegion.dstOffset = pending.dstOffset;
+		copyRegion.size = pending.size;
+		mCopyRegions.push_back(copyRegion);
+		bool runEnds = i + 1 == mPendingCopies.size() || mPendingCopies[i + 1].dstBuffer != pending.dstBuffer;
+		if (!runEnds)
+		{
+			continue;
+		}
+		VkCopyBufferInfo2 copyInfo{};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
+		copyInfo.pNext = nullptr;
+		copyInfo.srcBuffer = mStaging.buffer();
+		copyInfo.dstBuffer = pending.dstBuffer;
+		copyInfo.regionCount = static_cast<uint32_t>(mCopyRegions.size());
+		copyInfo.pRegions = mCopyRegions.data();
+		vkCmdCopyBuffer2(batch.commandBuffer, &copyInfo);
+		mCopyRegions.clear();
+	}
+	VK_CHECK(vkEndCommandBuffer(batch.commandBuffer));
+
+	batch.ticket = ++mSubmittedValue;
+	VkCommandBufferSubmitInfo commandBufferInfo = VkInitializer::createCommandBufferSubmitInfo(batch.commandBuffer);
+	VkSemaphoreSubmitInfo signalInfo = VkInitializer::createSemaphoreSubmitInfo(mTimeline, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, batch.ticket);
+	VkSubmitInfo2 submitInfo = VkInitializer::createSubmitInfo(&commandBufferInfo, &signalInfo, nullptr);
+	VK_CHECK(vkQueueSubmit2(mQueue, 1, &submitInfo, nullptr));
+
+	mStaging.close(batch.ticket);
+	mPendingCopies.clear();
+	mPendingBytes = 0;
+	mInFlight.push_back(std::move(batch));
+	return mSubmittedValue;
+}
+
+void UploadManager::recycleFinished()
+{
+	VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mTimeline, &mCompletedValue));
+	while (!mInFlight.empty() && mInFlight.front().ticket <= mCompletedValue)
+	{
+		mFreeCommandBuffers.push_back(mInFlight.front().commandBuffer);
+		mInFlight.pop_front();
+	}
+	mStaging.release(mCompletedValue);
+}
+
+void UploadManager::update()
+{
+	flush();
+	recycleFinished();
+}
+
+void UploadManager::wait(UploadTicket ticket)
+{
+	KS_PROFILE_FUNCTION();
+	if (ticket > mSubmittedValue)
+	{
+		flush();
+	}
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.pNext = nullptr;
+	waitInfo.flags = 0;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &mTimeline;
+	waitInfo.pValues = &ticket;
+	VK_CHECK(vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX));
+	recycleFinished();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include <deque>
+#include "../type.h"
+#include "stagingRing.h"
+
+//timeline value of the batch an upload went out with, complete once the timeline reaches it
+using UploadTicket = uint64_t;
+
+//batches buffer uploads onto the transfer queue (or whatever queue it is given) and tracks
+//them with a timeline semaphore instead of a fence per copy. not thread safe, used from the main thread
+class UploadManager
+{
+public:
+	void init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamilyIndex, VkDeviceSize stagingSize);
+	void destroy();
+	//data is copied to staging memory right away, the gpu copy goes out with the next flush().
+	//uploads larger than the free staging space are split, blocking only when the ring is full
+	UploadTicket uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	//submits everything staged so far as one batch
+	UploadTicket flush();
+	//flushes staged uploads and releases staging memory of finished batches, never blocks
+	void update();
+	//blocks, only meant for loading screens and headless captures
+	void wait(UploadTicket ticket);
+	bool isComplete(UploadTicket ticket) const { return ticket <= mCompletedValue; }
+	//value observed by the last update(), consumers wait on it to get the copies made visible
+	uint64_t completedValue() const { return mCompletedValue; }
+	//nothing staged or in flight as of the last update()
+	bool idle() const { return mPendingCopies.empty() && mInFlight.empty(); }
+	VkSemaphore timeline() const { return mTimeline; }
+	uint32_t queueFamilyIndex() const { return mQueueFamilyIndex; }
+private:
+	struct PendingCopy
+	{
+		VkBuffer	 dstBuffer;
+		VkDeviceSize dstOffset;
+		VkDeviceSize srcOffset;
+		VkDeviceSize size;
+	};
+	struct Batch
+	{
+		UploadTicket	ticket;
+		VkCommandBuffer commandBuffer;
+	};
+	void recycleFinished();
+private:
+	VkDevice					 mDevice{ nullptr };
+	VmaAllocator				 mAllocator{ nullptr };
+	VkQueue						 mQueue{ nullptr };
+	uint32_t					 mQueueFamilyIndex{ 0 };
+	VkCommandPool				 mCommandPool{ nullptr };
+	VkSemaphore					 mTimeline{ nullptr };
+	uint64_t					 mSubmittedValue{ 0 };
+	uint64_t					 mCompletedValue{ 0 };
+	//staged but not yet submitted
+	std::vector<PendingCopy>	 mPendingCopies;
+	std::vector<VkBufferCopy2>	 mCopyRegions;
+	VkDeviceSize				 mPendingBytes{ 0 };
+	StagingRing					 mStaging;
+	std::deque<Batch>			 mInFlight;
+	std::vector<VkCommandBuffer> mFreeCommandBuffers;
+};
@@ -1,24 +1,55 @@
 #include <fstream>
+#include <algorithm>
+#include <gtc/packing.hpp>
 #include "utils.h"
 #include "core.h"
 
-void Utils::loadShader(const char* filePath, VkDevice device, VkShaderModule* shaderModule)
+uint64_t Utils::hashBytes(const void* data, size_t size, uint64_t seed)
 {
-	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool Utils::saveImagePPM(const char* filePath, const ReadbackImage& image)
+{
+	if (image.format != VK_FORMAT_R16G16B16A16_SFLOAT && image.format != VK_FORMAT_R8G8B8A8_UNORM && image.format != VK_FORMAT_B8G8R8A8_UNORM)
+	{
+		KS_CORE_ERROR("saveImagePPM: unsupported format {}", string_VkFormat(image.format));
+		return false;
+	}
+	std::ofstream file(filePath, std::ios::binary);
 	if (!file.is_open())
 	{
-		KS_CORE_ASSERT(false, "Failed to open shader file!");
+		KS_CORE_ERROR("saveImagePPM: failed to open {}", filePath);
+		return false;
+	}
+	file << "P6\n" << image.extent.width << " " << image.extent.height << "\n255\n";
+	size_t texelCount = static_cast<size_t>(image.extent.width) * image.extent.height;
+	std::vector<uint8_t> rgb(texelCount * 3);
+	for (size_t i = 0; i < texelCount; i++)
+	{
+		for (size_t c = 0; c < 3; c++)
+		{
+			if (image.format == VK_FORMAT_R16G16B16A16_SFLOAT)
+			{
+				const uint16_t* texel = reinterpret_cast<const uint16_t*>(image.pixels.data()) + i * 4;
+				float value = glm::unpackHalf1x16(texel[c]);
+				rgb[i * 3 + c] = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			else
+			{
+				size_t channel = image.format == VK_FORMAT_B8G8R8A8_UNORM ? 2 - c : c;
+				rgb[i * 3 + c] = image.pixels[i * 4 + channel];
+			}
+		}
 	}
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(fileSize);
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-	file.close();
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.flags = 0;
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
-	createInfo.codeSize = buffer.size();
-	createInfo.pNext = nullptr;
-	VK_CHECK(vkCreateShaderModule(device, &createInfo, nullptr, shaderModule));
+	file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+	KS_CORE_INFO("Saved frame {} readback to {}", image.frameNumber, filePath);
+	return true;
 }
\ No newline at end of file
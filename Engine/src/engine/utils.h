@@ -1,7 +1,11 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include "type.h"
 
 namespace Utils
 {
-	void loadShader(const char* filePath, VkDevice device, VkShaderModule* shaderModule);
+	constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+	//fnv-1a, chain calls by passing the previous result as seed
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed = HASH_SEED);
+	bool saveImagePPM(const char* filePath, const ReadbackImage& image);
 }
\ No newline at end of file
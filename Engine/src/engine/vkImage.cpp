@@ -61,3 +61,59 @@ void vkutil::blitImage(VkCommandBuffer cmd, VkImage srcImage, VkImage dstImage,
     blitInfo.regionCount = 1;
     vkCmdBlitImage2(cmd, &blitInfo);
 }
+
+void vkutil::copyImageToBuffer(VkCommandBuffer cmd, VkImage srcImage, VkBuffer dstBuffer, VkExtent3D extent)
+{
+    VkBufferImageCopy2 copyRegion{ .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2, .pNext = nullptr };
+    copyRegion.bufferOffset = 0;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageOffset = { 0, 0, 0 };
+    copyRegion.imageExtent = extent;
+
+    VkCopyImageToBufferInfo2 copyInfo{ .sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_BUFFER_INFO_2 };
+    copyInfo.pNext = nullptr;
+    copyInfo.srcImage = srcImage;
+    copyInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    copyInfo.dstBuffer = dstBuffer;
+    copyInfo.regionCount = 1;
+    copyInfo.pRegions = &copyRegion;
+    vkCmdCopyImageToBuffer2(cmd, &copyInfo);
+
+    //make the copy visible to the host once the frame has been waited on
+    VkMemoryBarrier2 hostBarrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    hostBarrier.pNext = nullptr;
+    hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.pNext = nullptr;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &hostBarrier;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+uint32_t vkutil::formatTexelSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
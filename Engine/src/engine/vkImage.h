@@ -5,4 +5,6 @@ namespace vkutil
 {
 	void transitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
 	void blitImage(VkCommandBuffer cmd, VkImage srcImage, VkImage dstImage, VkExtent3D srcSize, VkExtent3D distSize);
+	void copyImageToBuffer(VkCommandBuffer cmd, VkImage srcImage, VkBuffer dstBuffer, VkExtent3D extent);
+	uint32_t formatTexelSize(VkFormat format);
 }
\ No newline at end of file
@@ -40,6 +40,16 @@ VkFenceCreateInfo VkInitializer::createFenceInfo(const VkFenceCreateFlags& f)
 	return info;
 }
 
+VkSemaphoreTypeCreateInfo VkInitializer::createSemaphoreTypeInfo(VkSemaphoreType type, uint64_t initialValue)
+{
+	VkSemaphoreTypeCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	info.pNext = nullptr;
+	info.semaphoreType = type;
+	info.initialValue = initialValue;
+	return info;
+}
+
 VkCommandBufferBeginInfo VkInitializer::createCommandBufferBeginInfo(const VkCommandBufferUsageFlags& f)
 {
 	VkCommandBufferBeginInfo info{};
@@ -63,6 +73,16 @@ VkSubmitInfo2 VkInitializer::createSubmitInfo(VkCommandBufferSubmitInfo* command
 	return info;
 }
 
+VkSubmitInfo2 VkInitializer::createSubmitInfo(VkCommandBufferSubmitInfo* commandBufferInfo, VkSemaphoreSubmitInfo* signalSemaphoreInfos, uint32_t signalCount, VkSemaphoreSubmitInfo* waitSemaphoreInfos, uint32_t waitCount)
+{
+	VkSubmitInfo2 info = createSubmitInfo(commandBufferInfo, nullptr, nullptr);
+	info.signalSemaphoreInfoCount = signalCount;
+	info.pSignalSemaphoreInfos = signalSemaphoreInfos;
+	info.waitSemaphoreInfoCount = waitCount;
+	info.pWaitSemaphoreInfos = waitSemaphoreInfos;
+	return info;
+}
+
 VkCommandBufferSubmitInfo VkInitializer::createCommandBufferSubmitInfo(const VkCommandBuffer& commandBuffer)
 {
 	VkCommandBufferSubmitInfo info;
@@ -73,7 +93,7 @@ VkCommandBufferSubmitInfo VkInitializer::createCommandBufferSubmitInfo(const VkC
 	return info;
 }
 
-VkSemaphoreSubmitInfo VkInitializer::createSemaphoreSubmitInfo(const VkSemaphore& semaphore, const VkPipelineStageFlags2& stageFlags)
+VkSemaphoreSubmitInfo VkInitializer::createSemaphoreSubmitInfo(const VkSemaphore& semaphore, const VkPipelineStageFlags2& stageFlags, uint64_t value)
 {
 	VkSemaphoreSubmitInfo info{};
 	info.deviceIndex = 0;
@@ -81,7 +101,7 @@ VkSemaphoreSubmitInfo VkInitializer::createSemaphoreSubmitInfo(const VkSemaphore
 	info.semaphore = semaphore;
 	info.stageMask = stageFlags;
 	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-	info.value = 0;
+	info.value = value;
 	return info;
 }
 
@@ -126,6 +146,11 @@ VkImageViewCreateInfo VkInitializer::createImageViewInfo(VkImage image, VkFormat
 }
 
 AllocatedBuffer VkInitializer::createBuffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags flags, VmaMemoryUsage memoryUsage)
+{
+	return createBuffer(allocator, size, flags, memoryUsage, {});
+}
+
+AllocatedBuffer VkInitializer::createBuffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags flags, VmaMemoryUsage memoryUsage, const std::vector<uint32_t>& queueFamilies)
 {
 	AllocatedBuffer newBuffer;
 	VkBufferCreateInfo bufferInfo{};
@@ -134,6 +159,12 @@ AllocatedBuffer VkInitializer::createBuffer(VmaAllocator allocator, size_t size,
 	bufferInfo.size = size;
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.usage = flags;
+	if (queueFamilies.size() > 1)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+	}
 	
 	VmaAllocationCreateInfo vmaInfo{};
 	vmaInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
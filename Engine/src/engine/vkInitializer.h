@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include <vulkan/vulkan.h>
 #include "type.h"
 
@@ -10,12 +11,16 @@ public:
 	static VkSemaphoreCreateInfo createSemaphoreInfo(const VkSemaphoreCreateFlags& f);
 	static VkFenceCreateInfo createFenceInfo(const VkFenceCreateFlags& f);
 	static VkCommandBufferBeginInfo createCommandBufferBeginInfo(const VkCommandBufferUsageFlags& f);
+	static VkSemaphoreTypeCreateInfo createSemaphoreTypeInfo(VkSemaphoreType type, uint64_t initialValue);
 	static VkSubmitInfo2 createSubmitInfo(VkCommandBufferSubmitInfo* commandBufferInfo, VkSemaphoreSubmitInfo* signalSemaphoreInfo, VkSemaphoreSubmitInfo* waitSemaphoreInfo);
+	static VkSubmitInfo2 createSubmitInfo(VkCommandBufferSubmitInfo* commandBufferInfo, VkSemaphoreSubmitInfo* signalSemaphoreInfos, uint32_t signalCount, VkSemaphoreSubmitInfo* waitSemaphoreInfos, uint32_t waitCount);
 	static VkCommandBufferSubmitInfo createCommandBufferSubmitInfo(const VkCommandBuffer& commandBuffer);
-	static VkSemaphoreSubmitInfo createSemaphoreSubmitInfo(const VkSemaphore& semaphore, const VkPipelineStageFlags2& stageFlags);
+	static VkSemaphoreSubmitInfo createSemaphoreSubmitInfo(const VkSemaphore& semaphore, const VkPipelineStageFlags2& stageFlags, uint64_t value = 0);
 	static VkImageSubresourceRange imageSubresourceRange(VkImageAspectFlags aspectMask);
 	static VkImageCreateInfo createImageInfo(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent);
 	static VkImageViewCreateInfo createImageViewInfo(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkExtent3D extent);
 	static AllocatedBuffer createBuffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags flags, VmaMemoryUsage memoryUsage);
+	//CONCURRENT when more than one queue family accesses the buffer, saves ownership transfers
+	static AllocatedBuffer createBuffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags flags, VmaMemoryUsage memoryUsage, const std::vector<uint32_t>& queueFamilies);
 	static AllocatedImage createImage(VkDevice device, VmaAllocator allocator, VkExtent3D extent, VkFormat format, VkImageUsageFlags flags, VkImageAspectFlags aspect);
 };
\ No newline at end of file
@@ -1,27 +1,58 @@
 #version 460 core
 #extension GL_EXT_buffer_reference : require
  
- struct Vertex
+ layout(location = 0) out vec4 outColor;
+
+ struct Object
  {
- 	vec4 position;
-	vec4 color;
+	mat4 model;
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+	uint flags;
+	vec4 boundsMin;
+	vec4 boundsMax;
+	vec4 positionOffset;
+	vec4 positionScale;
+ };
+
+ layout(buffer_reference, std430) readonly buffer ObjectBuffer
+ {
+	Object objects[];
  };
 
- layout(location = 0) out vec4 outColor;
  layout(buffer_reference, std430) readonly buffer VertexBuffer
  {
-	Vertex vertices[];
- } vertexBuffer;
+	//PackedVertex: x = position xy unorm16, y = position z unorm16 and flags, z = octahedral normal and tangent, w = half uv
+	uvec4 vertices[];
+ };
 
- layout(push_constant) uniform ModelInfo
+ layout(push_constant) uniform DrawInfo
  {
-	mat4 modelMatrix;
+	mat4 viewProj;
 	VertexBuffer vBuffer;
- } modelInfo;
+	ObjectBuffer objectBuffer;
+ } drawInfo;
+
+ vec3 octDecode(vec2 encoded)
+ {
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	//unfold the lower hemisphere
+	float fold = max(-direction.z, 0.0);
+	direction.x += direction.x >= 0.0 ? -fold : fold;
+	direction.y += direction.y >= 0.0 ? -fold : fold;
+	return normalize(direction);
+ }
 
  void main()
  {
-	Vertex v = modelInfo.vBuffer.vertices[gl_VertexIndex];
-	outColor = v.color;
-	gl_Position = modelInfo.modelMatrix * vec4(v.position);
+	//firstInstance of the indirect command is the object index
+	Object object = drawInfo.objectBuffer.objects[gl_InstanceIndex];
+	uvec4 vertex = drawInfo.vBuffer.vertices[gl_VertexIndex];
+	//dequantize inside the mesh's bounds
+	vec3 position = object.positionOffset.xyz + vec3(unpackUnorm2x16(vertex.x), unpackUnorm2x16(vertex.y).x) * object.positionScale.xyz;
+	vec3 normal = octDecode(unpackSnorm4x8(vertex.z).xy);
+	//object space normal as color, there is no material yet
+	outColor = vec4(normal * 0.5 + 0.5, 1.0);
+	gl_Position = drawInfo.viewProj * object.model * vec4(position, 1.0);
  }
\ No newline at end of file